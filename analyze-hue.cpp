@@ -1,16 +1,21 @@
+#include <paintings/pool.h>
+#include <paintings/files.h>
+#include <paintings/store.h>
+#include <paintings/analysis.h>
+
 #include <fmt/printf.h>
 
 #include <CLI/App.hpp>
 #include <CLI/Config.hpp>
 #include <CLI/Formatter.hpp>
 
-#define STB_IMAGE_IMPLEMENTATION
-
-#include <stb_image.h>
-
 #include <nlohmann/json.hpp>
 
 #include <array>
+#include <cctype>
+#include <memory>
+#include <algorithm>
+#include <optional>
 #include <filesystem>
 
 using nlohmann::json;
@@ -19,108 +24,23 @@ namespace fs = std::filesystem;
 
 struct Options {
     std::string input;
+    std::string store;
     bool external = false;
+    bool quantiles = false;
 
     Options(int count, const char **args) {
         CLI::App app("Hue analyzer for images.");
 
         app.add_option("-i", input, "Input CSV database file for MET.")->required();
         app.add_flag("-e", external, "Output subsample file for future processing.");
+        app.add_flag("-q,--quantiles", quantiles, "Also give the median and 5th/95th percentile of each class.");
+        app.add_option("-s,--store", store, "Result store file, shared with paintings for files named by object ID."
+            " Only one process can have it open at a time.");
 
         app.parse(count, args);
     }
 };
 
-struct ImageData {
-    int32_t width = 0;
-    int32_t height = 0;
-    uint8_t *data = nullptr;
-
-    explicit ImageData(const std::string &path) {
-        data = stbi_load(path.c_str(), &width, &height, nullptr, 3);
-
-        if (!data)
-            throw std::runtime_error("Something went horribly wrong...");
-    }
-
-    ~ImageData() {
-        stbi_image_free(data);
-    }
-};
-
-struct RGB {
-    uint8_t red = 0;
-    uint8_t green = 0;
-    uint8_t blue = 0;
-};
-
-struct HSL {
-    double hue = 0;
-    double saturation = 0;
-    double lightness = 0;
-
-    explicit HSL(const RGB &rgb) {
-        double r = static_cast<double>(rgb.red) / 255.0;
-        double g = static_cast<double>(rgb.green) / 255.0;
-        double b = static_cast<double>(rgb.blue) / 255.0;
-
-        double max = std::max(std::max(r, g), b);
-        double min = std::min(std::min(r, g), b);
-        double diff = max - min;
-
-        lightness = (max + min) / 2;
-
-        if (diff == 0) {
-            hue = 0;
-            saturation = 0;
-        } else {
-            if (r == max) {
-                hue = 60 * (g - b) / diff;
-                if (hue < 0)
-                    hue += 360;
-            } else if (g == max) {
-                hue = 60 * ((b - r) / diff + 2.0);
-            } else if (b == max) {
-                hue = 60 * ((r - g) / diff + 4.0);
-            }
-
-            saturation = diff / (1 - std::abs(2 * lightness - 1));
-        }
-    }
-};
-
-constexpr std::array samples = {
-    "RED",
-    "YELLOW",
-    "GREEN",
-    "CYAN",
-    "BLUE",
-    "MAGENTA",
-    "WHITE",
-    "BLACK",
-    "GRAY"
-};
-
-std::string join(const std::array<uint64_t, samples.size()> &arr) {
-    std::array<std::string, samples.size()> texts;
-
-    for (size_t a = 0; a < samples.size(); a++) {
-        texts[a] = fmt::format("{:>10}: {}", samples[a], arr[a]);
-    }
-
-    return fmt::format("{}", fmt::join(texts, "\n"));
-}
-
-std::string join(const std::array<double, samples.size()> &arr) {
-    std::array<std::string, samples.size()> texts;
-
-    for (size_t a = 0; a < samples.size(); a++) {
-        texts[a] = fmt::format("{:>10}: %{:.1f}", samples[a], arr[a] * 100);
-    }
-
-    return fmt::format("{}", fmt::join(texts, "\n"));
-}
-
 template <typename T>
 json create(const std::array<T, samples.size()> &arr) {
     json result;
@@ -132,168 +52,65 @@ json create(const std::array<T, samples.size()> &arr) {
     return result;
 }
 
-struct AnalysisResult {
-    uint64_t numPixels = 0;
-    std::array<uint64_t, samples.size()> sampleFrequency = { };
-
-    std::array<double, samples.size()> normalize() const {
-        std::array<double, samples.size()> result = { };
-
-        auto normalize = [this](uint64_t i) {
-            return static_cast<double>(i) / static_cast<double>(numPixels);
-        };
-
-        std::transform(sampleFrequency.begin(), sampleFrequency.end(), result.begin(), normalize);
-
-        return result;
-    }
-
-    std::string toString() const {
-        return fmt::format(
-            "Pixel Count: {}\n"
-            "Sample Frequency:\n{}\n"
-            "Sample Normalized:\n{}\n",
-            numPixels,
-            join(sampleFrequency),
-            join(normalize()));
-    }
-
-    json toJson() const {
-        return {
-            { "pixelCount", std::to_string(numPixels) },
-            { "sampleFrequencies", create(sampleFrequency) },
-            { "sampleNormalized", create(normalize()) }
-        };
-    }
-
-    AnalysisResult() = default;
-    explicit AnalysisResult(const ImageData &image) {
-        numPixels = image.width * image.height;
-
-        const RGB *colors = reinterpret_cast<RGB *>(image.data);
+json toJson(const AnalysisResult &result) {
+    return {
+        { "pixelCount", std::to_string(result.numPixels) },
+        { "sampleFrequencies", create(result.sampleFrequency) },
+        { "sampleNormalized", create(result.normalized) }
+    };
+}
 
-        for (uint64_t a = 0; a < numPixels; a++) {
-            const RGB &color = colors[a];
-            HSL hsl(color);
+json toJson(const AnalysisPool &pool) {
+    return {
+        { "totalPictures", std::to_string(pool.totalPictures) },
+        { "totalPixels", std::to_string(pool.totalPixels) },
+        { "rawFrequencies", create(pool.rawFrequency) },
+        { "rawNormalized", create(pool.rawNormalized) },
+        { "avgNormalized", create(pool.avgNormal) },
+        { "minNormalized", create(pool.minNormal) },
+        { "maxNormalized", create(pool.maxNormal) },
+        { "standardDeviation", create(pool.standardDeviation) }
+    };
+}
 
-            if (hsl.lightness < 0.03) {
-                sampleFrequency[6]++; // black
-            } else if (hsl.lightness > 0.9) {
-                sampleFrequency[7]++; // white
-            } else if (hsl.saturation < 0.15) {
-                sampleFrequency[8]++; // gray
-            } else {
-                size_t index = std::fmod(hsl.hue + 30.0, 360.0) / 60.0;
+// Estimated from the accumulator's sketches.
+std::array<double, samples.size()> quantiles(const PoolAccumulator &accumulator, double q) {
+    std::array<double, samples.size()> values;
 
-                sampleFrequency[index]++;
-            }
-        }
-    }
-};
+    for (size_t a = 0; a < samples.size(); a++)
+        values[a] = accumulator.quantile(a, q);
 
-struct AnalysisPool {
-    uint64_t totalPictures = 0;
+    return values;
+}
 
-    uint64_t totalPixels = 0;
-    std::array<uint64_t, samples.size()> rawFrequency = { };
+// Files named by their MET object ID ("436535.jpg") share results with paintings through the store.
+std::optional<uint64_t> objectId(const fs::path &path) {
+    std::string stem = path.stem().string();
 
-    std::array<double, samples.size()> avgNormal = { };
-    std::array<double, samples.size()> minNormal = { };
-    std::array<double, samples.size()> maxNormal = { };
-    std::array<double, samples.size()> standardDeviation = { };
+    // isdigit is undefined for negative chars, as bytes of non-ASCII names are where char is signed.
+    auto digit = [](unsigned char c) { return std::isdigit(c) != 0; };
 
-    std::array<double, samples.size()> rawNormalize() const {
-        std::array<double, samples.size()> result = { };
+    if (stem.empty() || stem.size() > 18 || !std::all_of(stem.begin(), stem.end(), digit))
+        return std::nullopt;
 
-        auto normalize = [this](uint64_t i) {
-            return static_cast<double>(i) / static_cast<double>(totalPixels);
-        };
+    return std::stoull(stem);
+}
 
-        std::transform(rawFrequency.begin(), rawFrequency.end(), result.begin(), normalize);
+AnalysisResult analyze(const fs::path &path, ResultStore *store) {
+    std::optional<uint64_t> id = store ? objectId(path) : std::nullopt;
 
+    AnalysisResult result;
+    if (id && store->find(*id, 1, result))
         return result;
-    }
 
-    std::string toString() const {
-        return fmt::format(
-            "Total Pictures: {}\n"
-            "Total Pixels: {}\n"
-            "Raw Frequencies:\n{}\n"
-            "Raw Normal:\n{}\n"
-            "Average Normal:\n{}\n"
-            "Min Normal:\n{}\n"
-            "Max Normal:\n{}\n"
-            "Standard Deviation:\n{}\n",
-            totalPictures,
-            totalPixels,
-            join(rawFrequency),
-            join(rawNormalize()),
-            join(avgNormal),
-            join(minNormal),
-            join(maxNormal),
-            join(standardDeviation));
-    }
-
-    json toJson() const {
-        return {
-            { "totalPictures", std::to_string(totalPictures) },
-            { "totalPixels", std::to_string(totalPixels) },
-            { "rawFrequencies", create(rawFrequency) },
-            { "rawNormalized", create(rawNormalize()) },
-            { "avgNormalized", create(avgNormal) },
-            { "minNormalized", create(minNormal) },
-            { "maxNormalized", create(maxNormal) },
-            { "standardDeviation", create(standardDeviation) }
-        };
-    }
-
-    explicit AnalysisPool(const std::vector<AnalysisResult> &results) {
-        if (results.empty())
-            return;
-
-        totalPictures = results.size();
-
-        for (const AnalysisResult &result : results) {
-            totalPixels += result.numPixels;
+    ImageData data(path);
+    result = AnalysisResult(data);
 
-            auto normal = result.normalize();
-
-            for (size_t a = 0; a < samples.size(); a++) {
-                rawFrequency[a] += result.sampleFrequency[a];
-                avgNormal[a] += normal[a];
-            }
-        }
-
-        for (double &normal : avgNormal) {
-            normal /= static_cast<double>(totalPictures);
-        }
+    if (id)
+        store->insert(*id, 1, result);
 
-        minNormal = results.front().normalize();
-        maxNormal = minNormal;
-
-        // Second pass for min/max normals and SD
-        for (const AnalysisResult &result : results) {
-            auto normals = result.normalize();
-
-            for (size_t a = 0; a < samples.size(); a++) {
-                if (minNormal[a] > normals[a])
-                    minNormal[a] = normals[a];
-
-                if (maxNormal[a] < normals[a])
-                    maxNormal[a] = normals[a];
-
-                double diffMean = normals[a] - avgNormal[a];
-                standardDeviation[a] += diffMean * diffMean;
-            }
-        }
-
-        if (results.size() >= 2) {
-            for (double &sd : standardDeviation) {
-                sd = std::sqrt(sd / (totalPictures - 1.0));
-            }
-        }
-    }
-};
+    return result;
+}
 
 int main(int count, const char **args) {
     Options options(count, args);
@@ -304,40 +121,48 @@ int main(int count, const char **args) {
         return 1;
     }
 
-    if (fs::is_directory(path)) {
-        std::vector<AnalysisResult> results;
-
-        for (const auto &file : fs::recursive_directory_iterator(path)) {
-            if (fs::is_directory(file))
-                continue;
-
-            fs::path p = file.path();
-            fs::path extension = p.extension();
+    std::unique_ptr<ResultStore> store;
+    if (!options.store.empty())
+        store = std::make_unique<ResultStore>(options.store);
 
-            if (!(extension == ".jpg" || extension == ".jpeg" || extension == ".png"))
-                continue;
+    if (fs::is_directory(path)) {
+        // Results are pooled as they come, however many images there are.
+        PoolAccumulator accumulator(options.quantiles);
 
+        for (const fs::path &p : imageFiles(path)) {
             if (!options.external) {
-                fmt::print("Processing {}...\n", p);
+                fmt::print("Processing {}...\n", p.string());
             }
 
-            ImageData data(p);
-            results.emplace_back(data);
+            accumulator.add(analyze(p, store.get()));
         }
 
-        AnalysisPool pool(results);
+        AnalysisPool pool(accumulator);
 
         if (options.external) {
-            fmt::print("{}\n", pool.toJson().dump(4));
+            json output = toJson(pool);
+
+            if (options.quantiles) {
+                output["medianNormalized"] = create(quantiles(accumulator, 0.5));
+                output["p5Normalized"] = create(quantiles(accumulator, 0.05));
+                output["p95Normalized"] = create(quantiles(accumulator, 0.95));
+            }
+
+            fmt::print("{}\n", output.dump(4));
         } else {
             fmt::print("\n{}\n", pool.toString());
+
+            if (options.quantiles) {
+                fmt::print("Median Normal:\n{}\n5th Percentile Normal:\n{}\n95th Percentile Normal:\n{}\n",
+                    join(quantiles(accumulator, 0.5)), join(quantiles(accumulator, 0.05)),
+                    join(quantiles(accumulator, 0.95)));
+            }
         }
     } else {
-        ImageData data(path);
-        AnalysisResult result(data);
+        AnalysisResult result = analyze(path, store.get());
 
         if (options.external) {
-            fmt::print("{}\n", result.toJson().dump(4));
+            fmt::print("{}\n", toJson(result).dump(4));
         } else {
             fmt::print("{}\n", result.toString());
         }
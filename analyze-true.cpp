@@ -1,90 +1,51 @@
-#include <fmt/printf.h>
+#include <paintings/files.h>
+#include <paintings/image.h>
+#include <paintings/kernel.h>
+#include <paintings/classifier.h>
 
-#define STB_IMAGE_IMPLEMENTATION
+#include <fmt/printf.h>
 
-#include <stb_image.h>
+#include <CLI/App.hpp>
+#include <CLI/Config.hpp>
+#include <CLI/Formatter.hpp>
 
 #include <array>
 #include <filesystem>
 
 namespace fs = std::filesystem;
 
-struct ImageData {
-    int32_t width = 0;
-    int32_t height = 0;
-    uint8_t *data = nullptr;
+struct Options {
+    std::string input;
 
-    explicit ImageData(const std::string &path) {
-        int32_t channels;
-        data = stbi_load(path.c_str(), &width, &height, &channels, 3);
+    Options(int count, const char **args) {
+        CLI::App app("Nearest true color analyzer for images.");
 
-        if (!data || channels != 3)
-            throw std::runtime_error("Something went horribly wrong...");
-    }
-
-    ~ImageData() {
-        stbi_image_free(data);
+        parseImageOptions(app, input, count, args);
     }
 };
 
-struct Color {
-    uint8_t red = 0;
-    uint8_t green = 0;
-    uint8_t blue = 0;
-
-    std::tuple<uint64_t, uint64_t> difference(const Color &other) const {
-        uint64_t diffRed = std::max(red, other.red) - std::min(red, other.red);
-        uint64_t diffGreen = std::max(green, other.green) - std::min(green, other.green);
-        uint64_t diffBlue = std::max(blue, other.blue) - std::min(blue, other.blue);
-
-        return std::make_tuple(
-            diffRed + diffGreen + diffBlue,
-            diffRed * diffRed + diffGreen * diffGreen + diffBlue * diffBlue);
-    }
-
-    constexpr explicit Color(uint32_t color) noexcept {
-        red = (color & 0xFF0000u) >> 16u;
-        green = (color & 0x00FF00u) >> 8u;
-        blue = (color & 0x0000FFu);
-    }
-};
-
-constexpr std::array samples = {
-    std::make_tuple(Color(0xFFFFFF), "WHITE"), // white
-    std::make_tuple(Color(0x000000), "BLACK"), // black
-    std::make_tuple(Color(0xFF0000), "RED"), // red
-    std::make_tuple(Color(0x00FF00), "GREEN"), // green
-    std::make_tuple(Color(0x0000FF), "BLUE"), // blue
-    std::make_tuple(Color(0xFFFF00), "YELLOW"), // yellow
-    std::make_tuple(Color(0x00FFFF), "CYAN"), // cyan
-    std::make_tuple(Color(0xFF00FF), "MAGENTA"), // magenta
-    std::make_tuple(Color(0x808080), "GRAY"), // gray
-    std::make_tuple(Color(0xFFA500), "ORANGE"), // orange
-    std::make_tuple(Color(0x800080), "PURPLE"), // purple
-};
-
 struct AnalysisResults {
     uint64_t numPixels = 0;
-    std::array<uint64_t, samples.size()> sampleFrequency = { };
-    std::array<uint64_t, samples.size()> squaredFrequency = { };
-    std::array<uint64_t, samples.size()> sampleScore = { };
-    std::array<uint64_t, samples.size()> squaredScore = { };
+    std::array<uint64_t, TrueColors::size> sampleFrequency = { };
+    std::array<uint64_t, TrueColors::size> squaredFrequency = { };
+    std::array<uint64_t, TrueColors::size> sampleScore = { };
+    std::array<uint64_t, TrueColors::size> squaredScore = { };
 
-    static std::string join(const std::array<uint64_t, samples.size()> &arr) {
-        std::array<std::string, samples.size()> texts;
+    static std::string join(const std::array<uint64_t, TrueColors::size> &arr) {
+        std::array<std::string, TrueColors::size> texts;
 
-        for (size_t a = 0; a < samples.size(); a++) {
-            texts[a] = fmt::format("{:>10}: {}", std::get<1>(samples[a]), arr[a]);
+        for (size_t a = 0; a < TrueColors::size; a++) {
+            texts[a] = fmt::format("{:>10}: {}", TrueColors::names[a], arr[a]);
         }
 
         return fmt::format("{}", fmt::join(texts, "\n"));
     }
 
-    static std::string join(const std::array<double, samples.size()> &arr) {
-        std::array<std::string, samples.size()> texts;
+    static std::string join(const std::array<double, TrueColors::size> &arr) {
+        std::array<std::string, TrueColors::size> texts;
 
-        for (size_t a = 0; a < samples.size(); a++) {
-            texts[a] = fmt::format("{:>10}: {:.3f}", std::get<1>(samples[a]), arr[a]);
+        for (size_t a = 0; a < TrueColors::size; a++) {
+            texts[a] = fmt::format("{:>10}: {:.3f}", TrueColors::names[a], arr[a]);
         }
 
         return fmt::format("{}", fmt::join(texts, "\n"));
@@ -95,10 +56,10 @@ struct AnalysisResults {
             return static_cast<double>(i) / static_cast<double>(numPixels);
         };
 
-        std::array<double, samples.size()> sampleNormalized = { };
+        std::array<double, TrueColors::size> sampleNormalized = { };
         std::transform(sampleFrequency.begin(), sampleFrequency.end(), sampleNormalized.begin(), normalize);
 
-        std::array<double, samples.size()> squaredNormalized = { };
+        std::array<double, TrueColors::size> squaredNormalized = { };
         std::transform(squaredFrequency.begin(), squaredFrequency.end(), squaredNormalized.begin(), normalize);
 
         return fmt::format(
@@ -118,71 +79,59 @@ struct AnalysisResults {
             join(squaredNormalized));
     }
 
-    explicit AnalysisResults(const ImageData &image) {
-        numPixels = image.width * image.height;
+    void add(const AnalysisResults &other) {
+        numPixels += other.numPixels;
 
-        const Color *colors = reinterpret_cast<Color *>(image.data);
+        for (size_t a = 0; a < TrueColors::size; a++) {
+            sampleFrequency[a] += other.sampleFrequency[a];
+            squaredFrequency[a] += other.squaredFrequency[a];
+            sampleScore[a] += other.sampleScore[a];
+            squaredScore[a] += other.squaredScore[a];
+        }
+    }
 
-        for (uint64_t a = 0; a < numPixels; a++) {
-            std::array<uint64_t, samples.size()> sumDifference = { };
-            std::array<uint64_t, samples.size()> squareDifference = { };
+    AnalysisResults() = default;
+    explicit AnalysisResults(const ImageData &image) {
+        numPixels = static_cast<uint64_t>(image.width) * static_cast<uint64_t>(image.height);
 
-            const Color &color = colors[a];
+        NearestCounts counts = {
+            sampleFrequency.data(),
+            squaredFrequency.data(),
+            sampleScore.data(),
+            squaredScore.data()
+        };
 
-            for (size_t b = 0; b < samples.size(); b++) {
-                const Color &sample = std::get<0>(samples[b]);
+        nearestPixels<TrueColors>(image.data, numPixels, counts);
+    }
+};
 
-                const auto [diff, squared] = sample.difference(color);
+int main(int count, const char **args) {
+    try {
+        Options options(count, args);
 
-                sumDifference[b] = diff;
-                squareDifference[b] = squared;
-            }
+        std::vector<fs::path> paths = imageFiles(options.input);
 
-            auto find = [](const std::array<uint64_t, samples.size()> &arr) {
-                size_t index = 0;
-                uint64_t value = ~0ull;
+        if (fs::is_directory(options.input)) {
+            AnalysisResults total;
 
-                for (size_t a = 0; a < arr.size(); a++) {
-                    if (arr[a] < value) {
-                        value = arr[a];
-                        index = a;
-                    }
-                }
+            for (const fs::path &path : paths) {
+                fmt::print("Processing {}...\n", path.string());
 
-                return std::make_tuple(index, value);
-            };
+                ImageData data(path);
+                total.add(AnalysisResults(data));
+            }
 
-            auto [diffIndex, diffValue] = find(sumDifference);
-            auto [squareIndex, squareValue] = find(squareDifference);
+            fmt::print("\n{}\n", total.toString());
+        } else {
+            ImageData data(paths.front());
+            AnalysisResults results(data);
 
-            sampleFrequency[diffIndex]++;
-            squaredFrequency[squareIndex]++;
-            sampleScore[diffIndex] += diffValue;
-            squaredScore[squareIndex] += squareValue;
+            fmt::print("{}\n", results.toString());
         }
-    }
-};
-
-int main(int count, const char **args) {
-    if (count != 2) {
-        fmt::print("Usage: analyze-true path/to/file");
-        return 1;
-    }
-
-    std::string path = args[1];
-    if (!fs::exists(path)) {
-        fmt::print("Could not find file or directory at \'{}\'.", path);
+    } catch (const std::runtime_error &e) {
+        fmt::print("{}\n", e.what());
         return 1;
     }
 
-    if (fs::is_directory(path)) {
-        throw std::runtime_error("oops");
-    } else {
-        ImageData data(path);
-        AnalysisResults results(data);
-
-        fmt::print("{}\n", results.toString());
-    }
-
     return 0;
 }
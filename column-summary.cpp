@@ -0,0 +1,82 @@
+#include <paintings/columns.h>
+
+#include <fmt/printf.h>
+
+#include <CLI/App.hpp>
+#include <CLI/Config.hpp>
+#include <CLI/Formatter.hpp>
+
+#include <chrono>
+
+struct Options {
+    std::string input;
+
+    Options(int count, const char **args) {
+        CLI::App app("Totals every class over a column file written with --format columns.");
+
+        app.add_option("-i,--input", input, "Column file.")->required();
+
+        try {
+            app.parse(count, args);
+        } catch (const CLI::ParseError &e) {
+            throw std::runtime_error(e.what());
+        }
+    }
+};
+
+int main(int count, const char **args) {
+    try {
+        Options options(count, args);
+
+        ColumnFile file(options.input);
+
+        auto start = std::chrono::steady_clock::now();
+
+        // Straight sums down each column, the compiler vectorizes these.
+        uint64_t pixels = 0;
+        std::vector<uint64_t> frequency(file.classes.size());
+        std::vector<double> normalized(file.classes.size());
+        double bytes = 0;
+
+        for (const ColumnFile::Chunk &chunk : file.chunks) {
+            for (size_t a = 0; a < chunk.rows; a++)
+                pixels += chunk.numPixels[a];
+
+            for (size_t b = 0; b < file.classes.size(); b++) {
+                uint64_t sum = 0;
+
+                for (size_t a = 0; a < chunk.rows; a++)
+                    sum += chunk.frequency[b][a];
+
+                frequency[b] += sum;
+
+                double shares = 0;
+
+                for (size_t a = 0; a < chunk.rows; a++)
+                    shares += chunk.normalized(a, b);
+
+                normalized[b] += shares;
+            }
+
+            bytes += static_cast<double>(ColumnFile::chunkBytes(chunk.rows, file.classes.size(), file.intervals));
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        fmt::print("Rows: {} in {} chunks\n", file.rows, file.chunks.size());
+        fmt::print("Total Pixels: {}\n", pixels);
+        fmt::print("Scan: {:.3f}s, {:.1f} MB/s\n\n", seconds, bytes / 1e6 / std::max(seconds, 1e-9));
+        fmt::print("{:>10} {:>16} {:>10} {:>10}\n", "Class", "Frequency", "Raw", "Average");
+
+        for (size_t b = 0; b < file.classes.size(); b++) {
+            fmt::print("{:>10} {:>16} {:>10.6f} {:>10.6f}\n", file.classes[b], frequency[b],
+                static_cast<double>(frequency[b]) / static_cast<double>(std::max<uint64_t>(pixels, 1)),
+                normalized[b] / static_cast<double>(std::max<size_t>(file.rows, 1)));
+        }
+    } catch (const std::runtime_error &e) {
+        fmt::print("{}\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
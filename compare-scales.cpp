@@ -0,0 +1,107 @@
+#include <paintings/files.h>
+#include <paintings/image.h>
+#include <paintings/analysis.h>
+
+#include <fmt/printf.h>
+
+#include <CLI/App.hpp>
+#include <CLI/Config.hpp>
+#include <CLI/Formatter.hpp>
+
+#include <array>
+#include <chrono>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+struct Options {
+    std::string input;
+    std::vector<int32_t> scales = { 2, 4, 8 };
+
+    Options(int count, const char **args) {
+        CLI::App app("Compares downscaled decodes against full resolution hue analysis.");
+
+        app.add_option("-s,--scales", scales, "Decode scales to compare against full resolution.")
+            ->check(CLI::IsMember({ 2, 4, 8 }));
+
+        parseImageOptions(app, input, count, args);
+    }
+};
+
+// How far one scale's normalized values land from full resolution, over every image.
+struct Drift {
+    size_t images = 0;
+    double seconds = 0;
+
+    std::array<double, samples.size()> mean = { };
+    std::array<double, samples.size()> max = { };
+
+    void add(const AnalysisResult &full, const AnalysisResult &scaled) {
+        images++;
+
+        for (size_t a = 0; a < samples.size(); a++) {
+            double drift = std::abs(scaled.normalized[a] - full.normalized[a]);
+
+            mean[a] += drift;
+            max[a] = std::max(max[a], drift);
+        }
+    }
+
+    std::string toString() const {
+        std::array<double, samples.size()> average = mean;
+
+        for (double &value : average)
+            value /= static_cast<double>(std::max<size_t>(images, 1));
+
+        return fmt::format(
+            "Decode Time: {:.3f}s\n"
+            "Mean Drift:\n{}\n"
+            "Max Drift:\n{}\n",
+            seconds,
+            join(average),
+            join(max));
+    }
+};
+
+AnalysisResult analyze(const std::vector<uint8_t> &bytes, int32_t scale, double &seconds) {
+    auto start = std::chrono::steady_clock::now();
+
+    auto reader = ImageReader::open(bytes.data(), bytes.size(), scale);
+    AnalysisResult result(*reader);
+
+    seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return result;
+}
+
+int main(int count, const char **args) {
+    try {
+        Options options(count, args);
+
+        std::vector<fs::path> paths = imageFiles(options.input);
+
+        double fullSeconds = 0;
+        std::vector<Drift> drifts(options.scales.size());
+
+        for (const fs::path &path : paths) {
+            fmt::print("Processing {}...\n", path.string());
+
+            std::vector<uint8_t> bytes = readFile(path);
+
+            AnalysisResult full = analyze(bytes, 1, fullSeconds);
+
+            for (size_t a = 0; a < options.scales.size(); a++)
+                drifts[a].add(full, analyze(bytes, options.scales[a], drifts[a].seconds));
+        }
+
+        fmt::print("\n# Full Resolution\nImages: {}\nDecode Time: {:.3f}s\n", paths.size(), fullSeconds);
+
+        for (size_t a = 0; a < options.scales.size(); a++)
+            fmt::print("\n# Scale 1/{}\n{}", options.scales[a], drifts[a].toString());
+    } catch (const std::runtime_error &e) {
+        fmt::print("{}\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
@@ -5,7 +5,7 @@
 #include <fmt/printf.h>
 
 #include <paintings/image.h>
-#include <paintings/colors.h>
+#include <paintings/classifier.h>
 
 #include <array>
 
@@ -30,7 +30,7 @@ struct Options {
     }
 };
 
-constexpr std::array colorValues = {
+constexpr std::array<RGB, HueColors::size> colorValues = {
     RGB(0xFF0000), // "RED",
     RGB(0xFFFF00), // "YELLOW",
     RGB(0x00FF00), // "GREEN",
@@ -50,8 +50,10 @@ int main(int count, const char **args) {
         RGB *input = reinterpret_cast<RGB *>(image.data);
         std::vector<RGB> output(image.width * image.height);
 
+        const ColorTable<HueColors> &table = ColorTable<HueColors>::get();
+
         for (size_t a = 0; a < image.width * image.height; a++)
-            output[a] = colorValues[HSL(input[a]).classify()];
+            output[a] = colorValues[table.classify(input[a])];
 
         stbi_write_png(
             options.output.c_str(), image.width, image.height,
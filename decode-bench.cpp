@@ -0,0 +1,109 @@
+#include <paintings/files.h>
+#include <paintings/decoder.h>
+#include <paintings/analysis.h>
+
+#include <fmt/printf.h>
+
+#include <CLI/App.hpp>
+#include <CLI/Config.hpp>
+#include <CLI/Formatter.hpp>
+
+#include <chrono>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+struct Options {
+    std::string input;
+    size_t repeats = 3;
+    int32_t scale = 1;
+
+    Options(int count, const char **args) {
+        CLI::App app("Measures decode throughput of every image decoder backend.");
+
+        app.add_option("-n,--repeats", repeats, "How many times each image is decoded per backend.");
+        app.add_option("-s,--scale", scale, "Decode at 1/scale of the full resolution.")
+            ->check(CLI::IsMember({ 1, 2, 4, 8 }));
+
+        parseImageOptions(app, input, count, args);
+    }
+};
+
+// Totals for one backend over every image it accepted.
+struct Throughput {
+    size_t images = 0;
+    size_t failures = 0;
+    double bytes = 0;
+    double pixels = 0;
+    double seconds = 0;
+
+    std::string toString() const {
+        return fmt::format(
+            "Images: {} ({} failed)\n"
+            "Decode Time: {:.3f}s\n"
+            "Compressed: {:.1f} MB/s\n"
+            "Decoded: {:.1f} MP/s\n",
+            images, failures,
+            seconds,
+            bytes / 1e6 / std::max(seconds, 1e-9),
+            pixels / 1e6 / std::max(seconds, 1e-9));
+    }
+};
+
+void decode(const Decoder &decoder, const std::vector<uint8_t> &bytes, const Options &options, Throughput &throughput) {
+    std::vector<uint8_t> rows;
+
+    for (size_t a = 0; a < options.repeats; a++) {
+        auto start = std::chrono::steady_clock::now();
+
+        auto reader = decoder.open(bytes.data(), bytes.size(), options.scale);
+        size_t batch = std::max<size_t>(streamPixels / std::max(reader->width, 1), 1);
+        rows.resize(static_cast<size_t>(reader->width) * 3 * batch);
+
+        size_t height = 0;
+        while (size_t count = reader->read(rows.data(), batch))
+            height += count;
+
+        throughput.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        throughput.bytes += static_cast<double>(bytes.size());
+        throughput.pixels += static_cast<double>(reader->width) * static_cast<double>(height);
+    }
+}
+
+int main(int count, const char **args) {
+    try {
+        Options options(count, args);
+
+        std::vector<fs::path> paths = imageFiles(options.input);
+
+        const auto &backends = decoders();
+        std::vector<Throughput> throughputs(backends.size());
+
+        for (const fs::path &path : paths) {
+            fmt::print("Processing {}...\n", path.string());
+
+            std::vector<uint8_t> bytes = readFile(path);
+
+            for (size_t a = 0; a < backends.size(); a++) {
+                if (!backends[a]->accepts(bytes.data(), bytes.size()))
+                    continue;
+
+                throughputs[a].images++;
+
+                try {
+                    decode(*backends[a], bytes, options, throughputs[a]);
+                } catch (const std::runtime_error &) {
+                    throughputs[a].failures++;
+                }
+            }
+        }
+
+        for (size_t a = 0; a < backends.size(); a++)
+            fmt::print("\n# {}\n{}", backends[a]->name(), throughputs[a].toString());
+    } catch (const std::runtime_error &e) {
+        fmt::print("{}\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
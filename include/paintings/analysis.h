@@ -1,31 +1,57 @@
 #pragma once
 
 #include <paintings/image.h>
+#include <paintings/classifier.h>
 
 #include <array>
 
-constexpr std::array samples = {
-    "RED",
-    "YELLOW",
-    "GREEN",
-    "CYAN",
-    "BLUE",
-    "MAGENTA",
-    "WHITE",
-    "BLACK",
-    "GRAY"
-};
+struct ThreadPool;
+
+constexpr auto samples = HueColors::names;
+
+// Bump whenever classification changes, so results stored by an older version are no longer found.
+constexpr uint32_t classifierVersion = 1;
+
+// Images with at least splitPixels pixels are classified in row bands of about bandPixels when given a pool.
+constexpr uint64_t splitPixels = 4'000'000;
+constexpr uint64_t bandPixels = 1'000'000;
+
+// Rows are streamed through a buffer of about this many pixels.
+constexpr uint64_t streamPixels = 64 * 1024;
 
 std::string join(const std::array<uint64_t, samples.size()> &arr);
 std::string join(const std::array<double, samples.size()> &arr);
 
+// Approximate mode draws random pixels, one from each of `strata` equal runs of the image per round,
+// doubling the strata every round until each class's 95% interval is narrower than `width`.
+// If that would take more than a quarter of the image it classifies every pixel instead.
+struct Approximation {
+    double width = 0.01;
+    uint64_t strata = 1024;
+    uint64_t seed = 0;
+};
+
 struct AnalysisResult {
+    // Pixels that were classified, all of the image or just the drawn ones in approximate mode.
+    // Always the sum of sampleFrequency.
     uint64_t numPixels = 0;
     std::array<uint64_t, samples.size()> sampleFrequency = { };
+    // sampleFrequency / numPixels, an estimate of each class's share of the image in approximate mode.
     std::array<double, samples.size()> normalized = { };
+    // 95% Wilson score interval of each class's share. It isn't centered on normalized but pulled towards 1/2, most
+    // for rare classes, and stays within [0, 1]. Both zero when every pixel was classified.
+    std::array<double, samples.size()> lower = { };
+    std::array<double, samples.size()> upper = { };
 
+    bool approximate() const;
     std::string toString() const;
 
     AnalysisResult() = default;
-    explicit AnalysisResult(const ImageData &image);
+    AnalysisResult(uint64_t numPixels, const std::array<uint64_t, samples.size()> &sampleFrequency);
+    explicit AnalysisResult(const ImageData &image, ThreadPool *pool = nullptr);
+    AnalysisResult(const ImageData &image, const Approximation &approximation, ThreadPool *pool = nullptr);
+    explicit AnalysisResult(ImageReader &reader);
+
+private:
+    void normalize();
 };
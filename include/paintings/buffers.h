@@ -0,0 +1,53 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Keeps freed pixel buffers around in size classes for the next image of about the same size, which skips the
+// mmap, page faults and munmap that a fresh allocation of a whole decoded image costs every time.
+struct BufferPool {
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+
+        // Buffers freed instead of kept because the pool was full.
+        uint64_t dropped = 0;
+        uint64_t retainedBytes = 0;
+
+        std::string toString() const;
+    };
+
+    // Anything smaller goes straight to malloc, only the pixel buffers are worth keeping.
+    static constexpr size_t pooledSize = 256 * 1024;
+
+    explicit BufferPool(size_t capacity);
+    ~BufferPool();
+
+    BufferPool(const BufferPool &) = delete;
+    BufferPool &operator=(const BufferPool &) = delete;
+
+    // malloc, realloc and free, null on failure. Blocks remember their size class, so release needs no size.
+    uint8_t *acquire(size_t size);
+    uint8_t *resize(uint8_t *data, size_t size);
+    void release(uint8_t *data);
+
+    // Most bytes kept around for reuse, releasing past this frees the buffer instead.
+    void setCapacity(size_t bytes);
+
+    Stats stats() const;
+
+    // Shared by every thread, stb_image allocates through it too.
+    static BufferPool &global();
+
+private:
+    // Four classes per power of two, so a pooled buffer is at most 25% larger than asked for.
+    static constexpr size_t classesPerDoubling = 4;
+
+    mutable std::mutex mutex;
+    size_t capacity;
+
+    Stats counters;
+    std::vector<std::vector<uint8_t *>> lists;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+#include <condition_variable>
+
+// Downloaded files on disk, keyed by object ID and URL and evicted least recently used first once the
+// directory grows past its capacity. Files are written under a temporary name and renamed into place, so
+// several processes can share one directory and never see half a file. Eviction scans the directory on a thread
+// of its own, one pass at a time, so a store that fills the cache doesn't wait for it.
+struct DiskCache {
+    DiskCache(const std::filesystem::path &directory, uint64_t capacity);
+    ~DiskCache();
+
+    DiskCache(const DiskCache &) = delete;
+    DiskCache &operator=(const DiskCache &) = delete;
+
+    // Both are best effort, a cache that can't be read or written just misses.
+    bool load(uint64_t objectId, const std::string &url, std::vector<uint8_t> &data);
+    void store(uint64_t objectId, const std::string &url, const std::vector<uint8_t> &data);
+
+private:
+    std::filesystem::path directory;
+    uint64_t capacity;
+
+    // Bytes written since the directory was last measured, added to what it held then.
+    std::mutex mutex;
+    uint64_t size = 0;
+
+    // A pass is asked for while the cache is over capacity and none is running. Bytes written during a pass are
+    // added to what it measured.
+    std::condition_variable evictions;
+    bool requested = false;
+    bool evicting = false;
+    bool stopping = false;
+    uint64_t written = 0;
+    std::thread evictor;
+
+    std::filesystem::path pathFor(uint64_t objectId, const std::string &url) const;
+
+    void evictThread();
+
+    // Removes the least recently used files until the directory is back under capacity, returns what it holds.
+    uint64_t evict();
+};
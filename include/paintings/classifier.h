@@ -0,0 +1,160 @@
+#pragma once
+
+#include <paintings/colors.h>
+
+#include <array>
+#include <cmath>
+#include <ratio>
+#include <vector>
+
+// Buckets pixels by HSL. Lightness under Black or over White and saturation under Gray come first,
+// everything else falls into one of six 60 degree hue sextants centered on the primaries.
+template <typename Black, typename White, typename Gray>
+struct HueClassifier {
+    static constexpr std::array names = {
+        "RED",
+        "YELLOW",
+        "GREEN",
+        "CYAN",
+        "BLUE",
+        "MAGENTA",
+        "WHITE",
+        "BLACK",
+        "GRAY"
+    };
+
+    static constexpr size_t size = names.size();
+
+    static constexpr double black = static_cast<double>(Black::num) / static_cast<double>(Black::den);
+    static constexpr double white = static_cast<double>(White::num) / static_cast<double>(White::den);
+    static constexpr double gray = static_cast<double>(Gray::num) / static_cast<double>(Gray::den);
+
+    // Integer forms for 8 bit channels with s = max + min and d = max - min, used by the vector kernels.
+    // s < blackSum is black, s > whiteSum is white, d * grayDiff < min(s, 510 - s) * grayDen is gray.
+    // The *Tie flags say whether s can land exactly on a threshold, where double rounding decides.
+    static constexpr int32_t blackSum = (510 * Black::num + Black::den - 1) / Black::den;
+    static constexpr bool blackTie = 510 * Black::num % Black::den == 0;
+    static constexpr int32_t whiteSum = 510 * White::num / White::den;
+    static constexpr bool whiteTie = 510 * White::num % White::den == 0;
+    static constexpr int32_t grayDiff = Gray::den;
+    static constexpr int32_t grayDen = Gray::num;
+
+    static_assert(255 * grayDiff < 32768 && 255 * grayDen < 32768, "Gray threshold needs 16 bit products.");
+
+    static size_t classify(const HSL &hsl) {
+        if (hsl.lightness < black) {
+            return 6; // black
+        } else if (hsl.lightness > white) {
+            return 7; // white
+        } else if (hsl.saturation < gray) {
+            return 8; // gray
+        } else {
+            return static_cast<size_t>(std::fmod(hsl.hue + 30.0, 360.0) / 60.0);
+        }
+    }
+
+    static size_t classify(const RGB &rgb) {
+        return classify(HSL(rgb));
+    }
+};
+
+// Buckets pixels by the nearest Palette::colors entry, by L1 or squared L2 distance over the channels.
+// Ties go to the earlier palette entry.
+template <typename Palette>
+struct NearestClassifier {
+    static constexpr auto colors = Palette::colors;
+    static constexpr auto names = Palette::names;
+
+    static constexpr size_t size = colors.size();
+
+    static_assert(names.size() == size, "Palette needs a name for every color.");
+
+    struct Match {
+        size_t index = 0;
+        uint64_t distance = 0;
+    };
+
+    template <bool squared>
+    static uint64_t distance(const RGB &a, const RGB &b) {
+        int32_t red = static_cast<int32_t>(a.red) - static_cast<int32_t>(b.red);
+        int32_t green = static_cast<int32_t>(a.green) - static_cast<int32_t>(b.green);
+        int32_t blue = static_cast<int32_t>(a.blue) - static_cast<int32_t>(b.blue);
+
+        if constexpr (squared)
+            return red * red + green * green + blue * blue;
+        else
+            return std::abs(red) + std::abs(green) + std::abs(blue);
+    }
+
+    template <bool squared>
+    static Match nearest(const RGB &rgb) {
+        Match match = { 0, distance<squared>(colors[0], rgb) };
+
+        for (size_t a = 1; a < size; a++) {
+            uint64_t value = distance<squared>(colors[a], rgb);
+            bool closer = value < match.distance;
+
+            match.index = closer ? a : match.index;
+            match.distance = closer ? value : match.distance;
+        }
+
+        return match;
+    }
+};
+
+struct TruePalette {
+    static constexpr std::array colors = {
+        RGB(0xFFFFFF),
+        RGB(0x000000),
+        RGB(0xFF0000),
+        RGB(0x00FF00),
+        RGB(0x0000FF),
+        RGB(0xFFFF00),
+        RGB(0x00FFFF),
+        RGB(0xFF00FF),
+        RGB(0x808080),
+        RGB(0xFFA500),
+        RGB(0x800080),
+    };
+
+    static constexpr std::array names = {
+        "WHITE",
+        "BLACK",
+        "RED",
+        "GREEN",
+        "BLUE",
+        "YELLOW",
+        "CYAN",
+        "MAGENTA",
+        "GRAY",
+        "ORANGE",
+        "PURPLE",
+    };
+};
+
+using HueColors = HueClassifier<std::ratio<3, 100>, std::ratio<9, 10>, std::ratio<15, 100>>;
+using TrueColors = NearestClassifier<TruePalette>;
+
+// Classifier::classify(rgb) for all 2^24 colors, built once on first use (16 MB).
+template <typename Classifier>
+struct ColorTable {
+    static_assert(Classifier::size < 256, "Classes have to fit in a byte.");
+
+    std::vector<uint8_t> classes;
+
+    size_t classify(const RGB &rgb) const {
+        return classes[(rgb.red << 16u) | (rgb.green << 8u) | rgb.blue];
+    }
+
+    static const ColorTable &get() {
+        static const ColorTable table;
+
+        return table;
+    }
+
+private:
+    ColorTable() : classes(1u << 24u) {
+        for (uint32_t a = 0; a < classes.size(); a++)
+            classes[a] = static_cast<uint8_t>(Classifier::classify(RGB(a)));
+    }
+};
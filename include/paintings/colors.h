@@ -21,6 +21,7 @@ struct HSL {
     double saturation = 0;
     double lightness = 0;
 
+    // Class under the default HueColors classifier.
     size_t classify() const;
 
     explicit HSL(const RGB &rgb);
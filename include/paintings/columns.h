@@ -0,0 +1,81 @@
+#pragma once
+
+#include <paintings/analysis.h>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Raw per-object results in a binary columnar file, for outputs too large to write or parse as CSV. Everything is
+// little endian and every section starts 8 byte aligned:
+//
+//   File header, 32 bytes: magic "PAINTCOL", format (u32), classes (u32), flags (u32, bit 0: intervals), 12 zero
+//   bytes, then one 16 byte NUL padded name per class.
+//
+//   Chunks to the end of the file, each a 16 byte header (magic "CHNK", rows as u32, bytes of columns as u64)
+//   followed by its columns, every column `rows` values long and zero padded to 8 bytes:
+//   sample (u32), object (u32), objectId (u64, zero when unknown), numPixels (u64), then the frequency of each
+//   class (u64), then when flagged the lower bound of each class's 95% interval (f64), then the upper bound of each.
+//
+// Samples and objects are numbered from one, like the CSV. Normalized shares are left out, they're each
+// frequency over numPixels. A run that dies can leave a chunk cut short at the end, readers skip it.
+struct ColumnFile {
+    struct Header {
+        char magic[8];
+        uint32_t format;
+        uint32_t classes;
+        uint32_t flags;
+        uint8_t padding[12];
+    };
+
+    struct ChunkHeader {
+        char magic[4];
+        uint32_t rows;
+        uint64_t bytes;
+    };
+
+    static constexpr char magic[8] = { 'P', 'A', 'I', 'N', 'T', 'C', 'O', 'L' };
+    static constexpr char chunkMagic[4] = { 'C', 'H', 'N', 'K' };
+    static constexpr uint32_t format = 2;
+    static constexpr uint32_t intervalFlag = 1;
+    static constexpr size_t nameSize = 16;
+
+    // Columns of one chunk, pointing straight into the mapped file.
+    struct Chunk {
+        size_t rows = 0;
+
+        const uint32_t *sample = nullptr;
+        const uint32_t *object = nullptr;
+        const uint64_t *objectId = nullptr;
+        const uint64_t *numPixels = nullptr;
+
+        // One column per class, interval bounds are empty without the flag.
+        std::vector<const uint64_t *> frequency;
+        std::vector<const double *> lower;
+        std::vector<const double *> upper;
+
+        double normalized(size_t row, size_t type) const {
+            return static_cast<double>(frequency[type][row]) / static_cast<double>(numPixels[row]);
+        }
+    };
+
+    // Maps the file read only, the chunks stay valid as long as this does.
+    explicit ColumnFile(const std::string &path);
+    ~ColumnFile();
+
+    ColumnFile(const ColumnFile &) = delete;
+    ColumnFile &operator=(const ColumnFile &) = delete;
+
+    std::vector<std::string> classes;
+    bool intervals = false;
+
+    std::vector<Chunk> chunks;
+    size_t rows = 0;
+
+    // Bytes of column data a chunk of `rows` rows takes.
+    static uint64_t chunkBytes(size_t rows, size_t classes, bool intervals);
+
+private:
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+};
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <paintings/image.h>
+
+#include <memory>
+#include <vector>
+
+// One image decoding backend. ImageReader::open tries every backend that accepts the data, in order.
+struct Decoder {
+    virtual const char *name() const = 0;
+
+    // Whether the data looks like a format this backend handles, from its magic bytes.
+    virtual bool accepts(const uint8_t *input, size_t size) const = 0;
+    virtual std::unique_ptr<ImageReader> open(const uint8_t *input, size_t size, int32_t scale) const = 0;
+
+    virtual ~Decoder() = default;
+};
+
+// Every backend built in, fastest first. stb_image is always last and accepts anything.
+const std::vector<const Decoder *> &decoders();
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <paintings/rate.h>
+
+#include <curl/curl.h>
+
+#include <deque>
+#include <mutex>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+#include <functional>
+
+// Runs every request on one thread through a curl multi handle, so hundreds can be in flight over a few
+// keep-alive connections, with DNS lookups and TLS sessions shared between them and easy handles reused.
+// A RateController paces starts, and throttled requests are retried after a delay before they fail.
+struct Downloader {
+    struct Response {
+        std::string url;
+        // HTTP errors (4xx, 5xx) come back as CURLE_HTTP_RETURNED_ERROR, with the code in status.
+        CURLcode error = CURLE_OK;
+        long status = 0;
+        std::vector<uint8_t> body;
+
+        // Header lines of the final response, without the status line or line endings.
+        std::vector<std::string> headers;
+
+        // Value of the named header (case-insensitive), empty when it wasn't sent.
+        std::string header(const std::string &name) const;
+    };
+
+    using Callback = std::function<void(Response &&)>;
+
+    // At most settings.maximum requests are in flight at once, requests past what the controller admits wait here.
+    explicit Downloader(const RateController::Settings &settings);
+    ~Downloader();
+
+    Downloader(const Downloader &) = delete;
+    Downloader &operator=(const Downloader &) = delete;
+
+    // Queues a GET. `done` runs on the download thread, so it should hand the response on and return.
+    void get(const std::string &url, Callback done);
+    std::future<Response> get(const std::string &url);
+
+    // Same, with extra request header lines such as "If-None-Match: ...".
+    void get(const std::string &url, std::vector<std::string> headers, Callback done);
+    std::future<Response> get(const std::string &url, std::vector<std::string> headers);
+
+    RateController::Stats stats();
+
+private:
+    struct Transfer {
+        Response response;
+        Callback done;
+
+        std::vector<std::string> headers;
+        curl_slist *headerList = nullptr;
+
+        size_t attempts = 0;
+        RateController::Clock::time_point due;
+    };
+
+    CURLM *multi = nullptr;
+    CURLSH *share = nullptr;
+
+    std::mutex mutex;
+    bool stopping = false;
+    std::deque<Transfer *> queued;
+    RateController controller;
+
+    // Only touched by the download thread.
+    size_t active = 0;
+    std::vector<CURL *> idle;
+    std::vector<Transfer *> delayed;
+
+    std::thread thread;
+
+    void start(Transfer *transfer);
+    void finish(CURL *handle, CURLcode error);
+    void downloadThread();
+};
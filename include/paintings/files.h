@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+
+namespace CLI {
+class App;
+}
+
+// The .jpg, .jpeg and .png files anywhere under input when it's a directory, or input itself when it isn't.
+std::vector<std::filesystem::path> imageFiles(const std::string &input);
+
+std::vector<uint8_t> readFile(const std::filesystem::path &path);
+
+// Command line of a tool run over image files: the file or directory, as -i/--input or the first argument, on
+// top of the tool's own options in app. Parse errors come out as runtime_error, like every other error.
+void parseImageOptions(CLI::App &app, std::string &input, int count, const char **args);
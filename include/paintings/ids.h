@@ -0,0 +1,21 @@
+#pragma once
+
+#include <paintings/download.h>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+
+// Object IDs all fit in 32 bits, which halves a full search's list next to size_t.
+using ObjectIds = std::vector<uint32_t>;
+
+// objectIDs of a /search response, picked out of the JSON as it's parsed instead of building the document.
+ObjectIds parseIds(const uint8_t *data, size_t size);
+
+// One ID per line, as create-sample writes them.
+ObjectIds readIds(const std::filesystem::path &path);
+
+// Runs the search, or with a cache directory revalidates the list kept there from an earlier run with its ETag
+// and Last-Modified, so an unchanged list costs one round trip and no parsing.
+ObjectIds searchIds(Downloader &downloader, const std::string &url, const std::filesystem::path &cacheDir);
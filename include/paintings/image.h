@@ -1,14 +1,42 @@
 #pragma once
 
+#include <memory>
 #include <string>
 
+// Decoding can shrink images by 1/2, 1/4 or 1/8 on each side. JPEGs are scaled in the DCT when built with
+// libjpeg, anything else is box filtered after a full decode.
+bool validDecodeScale(int32_t scale);
+
+// Pixels live in a buffer from BufferPool::global() and go back to it when the image is destroyed, so it can
+// be moved but not copied.
 struct ImageData {
     int32_t width = 0;
     int32_t height = 0;
     uint8_t *data = nullptr;
 
     explicit ImageData(const std::string &path);
-    ImageData(const uint8_t *input, size_t size);
+    ImageData(const uint8_t *input, size_t size, int32_t scale = 1);
+
+    ImageData(const ImageData &) = delete;
+    ImageData &operator=(const ImageData &) = delete;
+
+    ImageData(ImageData &&other) noexcept;
+    ImageData &operator=(ImageData &&other) noexcept;
 
     ~ImageData();
 };
+
+// Hands out an image a few interleaved RGB rows at a time, so it never has to sit in memory whole.
+struct ImageReader {
+    int32_t width = 0;
+    int32_t height = 0;
+
+    // Decodes up to `count` more rows into `rows` (count * width * 3 bytes), returns how many were written.
+    virtual size_t read(uint8_t *rows, size_t count) = 0;
+
+    virtual ~ImageReader() = default;
+
+    // Reads JPEGs scanline by scanline through libjpeg when built with it. Anything else is decoded whole
+    // by stb_image and copied out row by row. `input` has to outlive the reader.
+    static std::unique_ptr<ImageReader> open(const uint8_t *input, size_t size, int32_t scale = 1);
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <paintings/analysis.h>
+
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Append-only log of every object a sampling run finishes with, so a run that dies can be picked up again. Each
+// record is written as soon as its object is through, so the page cache holds it even if the process is killed,
+// and synced to disk in batches, at most every syncRecords records or syncInterval. Which objects go in which
+// sample follows from the seed, so that's kept once in the header instead of with every record.
+struct Journal {
+    struct Entry {
+        uint64_t objectId;
+
+        // Gave up on, samples picked another candidate in its place.
+        bool failed;
+        AnalysisResult result;
+    };
+
+    static constexpr size_t syncRecords = 256;
+    static constexpr std::chrono::seconds syncInterval{1};
+
+    // Starts a journal at path, or with resume reads back the one there, which has to be from a run with the same
+    // settings (whatever changes results, in any form). Refuses to start over a journal that isn't resumed.
+    Journal(const std::string &path, bool resume, uint64_t seed, const std::string &settings);
+    ~Journal();
+
+    Journal(const Journal &) = delete;
+    Journal &operator=(const Journal &) = delete;
+
+    // Seed of the run, the journal's own when resumed.
+    uint64_t seed;
+
+    // Objects read back on resume, in the order they finished.
+    std::vector<Entry> recovered;
+
+    void append(uint64_t objectId, const AnalysisResult &result);
+    void fail(uint64_t objectId);
+
+    struct Record;
+
+private:
+    std::string path;
+    int file = -1;
+
+    std::mutex mutex;
+    size_t unsynced = 0;
+    bool syncing = false;
+    std::chrono::steady_clock::time_point synced;
+
+    void write(Record &record);
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <paintings/classifier.h>
+
+#include <cstdint>
+#include <cstdlib>
+
+enum class Kernel {
+    Scalar,
+    SSE41,
+    AVX2,
+    AVX512
+};
+
+// Widest kernel supported by the running CPU.
+Kernel bestKernel();
+const char *kernelName(Kernel kernel);
+
+// Adds the class of `count` interleaved RGB pixels into `frequency` (Classifier::size entries).
+// Every kernel gives the same counts as Classifier::classify(). Instantiated in kernel.cpp for HueClassifier types.
+template <typename Classifier = HueColors>
+void classifyPixels(const uint8_t *pixels, size_t count, uint64_t *frequency, Kernel kernel = bestKernel());
+
+// Per class outputs of nearestPixels, each Classifier::size entries.
+struct NearestCounts {
+    uint64_t *sampleFrequency = nullptr;
+    uint64_t *squaredFrequency = nullptr;
+    uint64_t *sampleScore = nullptr;
+    uint64_t *squaredScore = nullptr;
+};
+
+// Finds the nearest palette color of `count` interleaved RGB pixels under L1 and squared L2 distance,
+// adding to the match frequencies and summed distances in one pass. Same results as Classifier::nearest().
+// AVX-512 machines run the AVX2 kernel. Instantiated in kernel.cpp for NearestClassifier types.
+template <typename Classifier = TrueColors>
+void nearestPixels(const uint8_t *pixels, size_t count, const NearestCounts &counts, Kernel kernel = bestKernel());
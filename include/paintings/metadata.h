@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+// The few fields of an /objects/{id} response the sampler looks at.
+struct ObjectMetadata {
+    std::string primaryImage;
+    std::string primaryImageSmall;
+    std::string dimensions;
+    bool isPublicDomain = false;
+};
+
+// Picks the fields above out of the response as it's parsed, without building the document, and stops as soon
+// as it has all of them. Fields the response doesn't have are left as they were. False when the response isn't
+// valid JSON up to that point.
+bool parseMetadata(const uint8_t *data, size_t size, ObjectMetadata &metadata);
@@ -3,16 +3,72 @@
 #include <string>
 
 struct Options {
+    // Sample draws live from the network, Index analyzes every object into the store once and Resample draws
+    // from the store alone. Calibrate analyzes one sample's objects from both image tiers and compares them.
+    enum class Mode { Sample, Index, Resample, Calibrate };
+
+    // Which of an object's images is analyzed, primaryImage or the much smaller primaryImageSmall.
+    enum class Tier { Full, Small, SmallOrFull };
+
+    Mode mode = Mode::Sample;
+    Tier tier = Tier::Full;
+
     std::string url = "https://collectionapi.metmuseum.org/public/collection/v1/";
     std::string search = "?hasImages=true&material=Paintings&q=*";
+
+    // Object IDs are read from this file instead of searching when set.
+    std::string idFile;
+
     size_t threads = 2;
+
+    // Requests in flight at once, metadata and images together. Fetches run on the downloader, no stage has
+    // threads waiting on them.
+    size_t connections = 64;
+
+    // Requests per second at most (zero for no ceiling), and tries again for a throttled request.
+    double maxRps = 0;
+    size_t retries = 3;
+
+    // Threads per CPU stage, each falls back to threads when zero.
+    size_t parseWorkers = 0;
+    size_t decodeWorkers = 0;
+    size_t classifyWorkers = 0;
+    size_t queueSize = 16;
+    bool stageReport = false;
+    size_t imageThreads = 0;
+
+    double approximate = 0;
+    bool stream = false;
+    int32_t decodeScale = 1;
+
+    // MiB of decoded pixel buffers kept around for reuse.
+    size_t bufferPool = 512;
+
+    // Downloaded images are kept here between samples and runs when set.
+    std::string cacheDir;
+    size_t cacheSize = 4096;
+
+    // Results of objects analyzed before are read from and written to this file when set.
+    std::string store;
     
+    // Finished objects are logged here when set, resume reads them back and only fetches what's missing.
+    std::string journal;
+    bool resume = false;
+
+    // Drawn from std::random_device unless given, printed either way so any run can be repeated.
+    uint64_t seed = 0;
+
     size_t sampleSize = 10;
     size_t sampleCount = 10;
 
     bool raw = false;
 
     std::string output;
+    std::string format = "csv";
 
     Options(int count, const char **args);
+
+    size_t workers(size_t stageWorkers) const {
+        return stageWorkers > 0 ? stageWorkers : threads;
+    }
 };
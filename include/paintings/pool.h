@@ -1,13 +1,42 @@
 #pragma once
 
+#include <paintings/sketch.h>
 #include <paintings/analysis.h>
 
 #include <array>
 #include <vector>
 
+// What AnalysisPool reports, kept up one result at a time in constant memory: sums, a running mean and squared
+// deviations (Welford) for the SD, and min/max. Accumulators over parts of the results, one per thread or shard,
+// merge into one over all of them (Chan et al.), which gives the same pool up to rounding.
+struct PoolAccumulator {
+    uint64_t count = 0;
+    uint64_t pixels = 0;
+    std::array<uint64_t, samples.size()> frequency = { };
+
+    // Plain sums of normalized shares, the average is taken from these so it comes out just as it always has.
+    std::array<double, samples.size()> sum = { };
+    std::array<double, samples.size()> mean = { };
+    std::array<double, samples.size()> squares = { };
+    std::array<double, samples.size()> min = { };
+    std::array<double, samples.size()> max = { };
+
+    // One per class when made with quantiles, empty otherwise.
+    std::vector<QuantileSketch> sketches;
+
+    explicit PoolAccumulator(bool quantiles = false);
+
+    void add(const AnalysisResult &result);
+    void merge(const PoolAccumulator &other);
+
+    // Estimated share of a class at quantile q, needs the sketches.
+    double quantile(size_t type, double q) const;
+};
+
 struct AnalysisPool {
     uint64_t totalPictures = 0;
 
+    // Sum of numPixels, so approximate results only count the pixels they classified.
     uint64_t totalPixels = 0;
     std::array<uint64_t, samples.size()> rawFrequency = { };
     std::array<double, samples.size()> rawNormalized = { };
@@ -20,4 +49,5 @@ struct AnalysisPool {
     std::string toString() const;
 
     explicit AnalysisPool(const std::vector<AnalysisResult> &results);
+    explicit AnalysisPool(const PoolAccumulator &accumulator);
 };
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <optional>
+#include <condition_variable>
+
+// Multi-producer multi-consumer queue holding at most `capacity` items. push blocks while it's full, which
+// slows the stage feeding it down to the pace of the stage draining it. Producers that mustn't block when their
+// item is ready, like download callbacks, reserve a place before they start on it instead.
+template<typename T>
+struct BoundedQueue {
+    // How full the queue has been, averaged over time since it was made.
+    struct Depth {
+        double average = 0;
+        size_t peak = 0;
+    };
+
+    const size_t capacity;
+
+    explicit BoundedQueue(size_t capacity) : capacity(capacity) { }
+
+    // False once the queue is closed, the item is dropped then.
+    bool push(T &&item) {
+        std::unique_lock lock(mutex);
+        notFull.wait(lock, [this] { return closed || items.size() + reserved < capacity; });
+
+        if (closed)
+            return false;
+
+        add(std::move(item));
+
+        return true;
+    }
+
+    // Holds a place for an item pushed later with pushReserved, blocks while items and held places fill the
+    // queue. False once the queue is closed.
+    bool reserve() {
+        std::unique_lock lock(mutex);
+        notFull.wait(lock, [this] { return closed || items.size() + reserved < capacity; });
+
+        if (closed)
+            return false;
+
+        reserved++;
+
+        return true;
+    }
+
+    // Fills a place held by reserve, never blocks. False once the queue is closed, the item is dropped then.
+    bool pushReserved(T &&item) {
+        std::lock_guard lock(mutex);
+        reserved--;
+
+        if (closed)
+            return false;
+
+        add(std::move(item));
+
+        return true;
+    }
+
+    // Empty once the queue is closed and drained.
+    std::optional<T> pop() {
+        std::unique_lock lock(mutex);
+        notEmpty.wait(lock, [this] { return closed || !items.empty(); });
+
+        if (items.empty())
+            return std::nullopt;
+
+        account();
+        std::optional<T> item(std::move(items.front()));
+        items.pop_front();
+
+        notFull.notify_one();
+
+        return item;
+    }
+
+    // Wakes everyone waiting, pushes fail from now on and pops do once the queue is drained.
+    void close() {
+        {
+            std::lock_guard lock(mutex);
+            closed = true;
+        }
+
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+
+    Depth depth() const {
+        std::lock_guard lock(mutex);
+
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - start).count();
+        double total = weighted + static_cast<double>(items.size()) * std::chrono::duration<double>(now - changed).count();
+
+        return { elapsed > 0 ? total / elapsed : 0, peak };
+    }
+
+private:
+    mutable std::mutex mutex;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+
+    bool closed = false;
+    std::deque<T> items;
+    size_t reserved = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point changed = start;
+    double weighted = 0;
+    size_t peak = 0;
+
+    // Called locked, with room for the item.
+    void add(T &&item) {
+        account();
+        items.push_back(std::move(item));
+        peak = std::max(peak, items.size());
+
+        notEmpty.notify_one();
+    }
+
+    // Adds the time spent at the current depth, called right before the depth changes.
+    void account() {
+        auto now = std::chrono::steady_clock::now();
+
+        weighted += static_cast<double>(items.size()) * std::chrono::duration<double>(now - changed).count();
+        changed = now;
+    }
+};
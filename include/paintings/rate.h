@@ -0,0 +1,92 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <cstddef>
+
+// Decides how many requests may be in flight and how fast new ones start, so the client finds the most the
+// server sustains instead of guessing. The window grows additively while responses come back fast and clean,
+// doubling at first like TCP slow start, and is cut by a factor on throttling (403, 429, 5xx, timeouts) or when
+// time to first byte climbs well above the best seen, at most once per window of responses. Each cut also paces
+// starts below the rate that drew it, which recovers additively the same way, and a configured requests per
+// second ceiling caps starts on top. Not thread safe, the Downloader calls it under its own lock.
+struct RateController {
+    using Clock = std::chrono::steady_clock;
+
+    enum class Outcome { Success, Throttled, Failed };
+
+    struct Settings {
+        size_t minimum = 1;
+        size_t initial = 4;
+        size_t maximum = 64;
+
+        // Starts per second at most, zero for no ceiling.
+        double requestsPerSecond = 0;
+
+        // Time to first byte this many times the best seen counts as the server queueing requests up.
+        double latencyFactor = 4;
+        double decrease = 0.5;
+
+        // Throttled requests are tried again this often before their failure is passed on.
+        size_t retries = 3;
+
+        // Longest Retry-After honored, a longer one (or one too big to parse) waits this long instead.
+        std::chrono::seconds maxRetryAfter = std::chrono::seconds(60);
+    };
+
+    struct Stats {
+        size_t requests = 0;
+        size_t throttled = 0;
+        size_t failed = 0;
+        size_t decreases = 0;
+        double window = 0;
+        double peakWindow = 0;
+        double pace = 0;
+
+        std::string toString() const;
+    };
+
+    explicit RateController(const Settings &settings);
+
+    // Whether one more request may start with `active` running, takes it out of the rate budget if so.
+    bool admit(size_t active, Clock::time_point now);
+
+    // How long until the rate ceiling lets the next request start, zero when it already does.
+    Clock::duration wait(Clock::time_point now) const;
+
+    void complete(Outcome outcome, Clock::duration firstByte);
+
+    // Delay before trying a throttled request again, for its `attempt`th retry.
+    Clock::duration retryDelay(size_t attempt) const;
+
+    const Settings &settings() const { return config; }
+    Stats stats() const;
+
+private:
+    Settings config;
+
+    double window;
+    double threshold;
+
+    // Requests per second found to keep the server from throttling, zero while there's no sign of a limit.
+    double pace = 0;
+
+    // Tokens of the rate ceiling, refilled continuously up to a tenth of a second's worth.
+    double tokens;
+    Clock::time_point refilled;
+
+    Clock::duration best = Clock::duration::max();
+    Clock::duration smoothed = Clock::duration::zero();
+
+    // No further decrease until this many more responses are in, the rest of the window was sent before the
+    // last one and says nothing about the new size.
+    double holdoff = 0;
+
+    Stats totals;
+
+    // Lower of the configured ceiling and the pace, zero when neither limits starts.
+    double ceiling() const;
+
+    void refill(Clock::time_point now);
+    void decrease();
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <paintings/ids.h>
+#include <paintings/pool.h>
+#include <paintings/options.h>
+#include <paintings/analysis.h>
+
+#include <random>
+#include <string>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+
+struct ThreadPool;
+struct DiskCache;
+struct ResultStore;
+struct Journal;
+struct Downloader;
+
+std::string concatURL(const std::string &a, const std::string &b);
+
+// SplitMix64, turns the run's seed and a sample number into that sample's own seed.
+uint64_t sampleSeed(uint64_t seed, uint64_t sample);
+
+// Visits 0 to size - 1 in a uniformly random order, one at a time. A Fisher-Yates shuffle that only remembers
+// the positions it has swapped, so drawing k of them costs O(k) whatever the size.
+struct ShuffledOrder {
+    size_t size;
+    size_t drawn = 0;
+
+    std::mt19937_64 generator;
+    std::unordered_map<size_t, size_t> swapped;
+
+    ShuffledOrder(size_t size, uint64_t seed) : size(size), generator(seed) { }
+
+    bool next(size_t &index) {
+        if (drawn >= size)
+            return false;
+
+        // Rejection instead of std::uniform_int_distribution, whose output differs between standard libraries.
+        uint64_t bound = size - drawn;
+        uint64_t limit = UINT64_MAX - UINT64_MAX % bound;
+
+        uint64_t value;
+        do {
+            value = generator();
+        } while (value >= limit);
+
+        size_t other = drawn + value % bound;
+
+        index = at(other);
+        swapped[other] = at(drawn);
+        drawn++;
+
+        return true;
+    }
+
+private:
+    size_t at(size_t position) const {
+        auto it = swapped.find(position);
+        return it == swapped.end() ? position : it->second;
+    }
+};
+
+// Results from primaryImageSmall go in the store under the negated decode scale, apart from full size ones.
+int32_t storeScale(const Options &options, bool small);
+
+// Everything an object's result and the samples' candidates depend on, a journal only resumes under the same.
+std::string journalSettings(const Options &options, const ObjectIds &ids);
+
+// Gets a complete sample's pool, and its results ranked with the object ID of each when they're kept. Called in
+// sample order, each as soon as it and every sample before it are complete, so output can be written while later
+// samples still run. Results go into the pool as they come in, not by rank, so its averages can differ from
+// AnalysisPool(results) in the last bits.
+using SampleDone = std::function<void(size_t sample, const PoolAccumulator &pool, std::vector<AnalysisResult> &&results,
+    std::vector<size_t> &&objectIds)>;
+
+// One sample per seed, each of sampleSize objects or every ID in order when exhaustive. All samples run together
+// as one pipeline, an object picked by several of them is only fetched and analyzed once. Without keepResults a
+// sample only holds its pool, whatever its size.
+void runSamples(const Options &options, const ObjectIds &ids, ThreadPool *pool, DiskCache *cache, ResultStore *store,
+    Journal *journal, Downloader &downloader, const std::vector<uint64_t> &seeds, bool exhaustive, bool keepResults,
+    const SampleDone &done);
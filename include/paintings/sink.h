@@ -0,0 +1,87 @@
+#pragma once
+
+#include <paintings/pool.h>
+#include <paintings/columns.h>
+#include <paintings/analysis.h>
+
+#include <fmt/format.h>
+
+#include <memory>
+#include <string>
+#include <fstream>
+
+// Writes results out as they come instead of all at the end. Rows are formatted into one reused buffer that's
+// written in blocks, and flush() pushes out everything so far, so output memory stays flat and a run that dies
+// keeps every sample flushed before it.
+struct ResultSink {
+    explicit ResultSink(const std::string &path);
+    virtual ~ResultSink();
+
+    // Samples and objects are numbered from zero here, from one in the output. An object ID of zero is unknown.
+    virtual void write(size_t sample, size_t object, size_t objectId, const AnalysisResult &result) = 0;
+    virtual void write(size_t sample, const AnalysisPool &pool) = 0;
+
+    virtual void flush();
+
+protected:
+    fmt::memory_buffer buffer;
+
+    // Called after every row, writes the buffer out once it holds a block.
+    void written();
+
+private:
+    std::string path;
+    std::ofstream stream;
+
+    void drain();
+};
+
+// One row per object (raw) or per sample, in the same columns the tool has always written.
+struct CsvSink : ResultSink {
+    CsvSink(const std::string &path, bool raw, bool intervals);
+
+    void write(size_t sample, size_t object, size_t objectId, const AnalysisResult &result) override;
+    void write(size_t sample, const AnalysisPool &pool) override;
+
+private:
+    bool intervals;
+};
+
+// One JSON object per line, classes keyed by name.
+struct NdjsonSink : ResultSink {
+    NdjsonSink(const std::string &path, bool intervals);
+
+    void write(size_t sample, size_t object, size_t objectId, const AnalysisResult &result) override;
+    void write(size_t sample, const AnalysisPool &pool) override;
+
+private:
+    bool intervals;
+};
+
+// Raw results only, in ColumnFile's layout. Rows are held until a chunk's worth is in, and a flush only writes
+// them out once there are enough for a chunk that's still worth scanning, so a run that dies loses at most that.
+struct ColumnSink : ResultSink {
+    ColumnSink(const std::string &path, bool intervals);
+    ~ColumnSink() override;
+
+    void write(size_t sample, size_t object, size_t objectId, const AnalysisResult &result) override;
+    void write(size_t sample, const AnalysisPool &pool) override;
+
+    void flush() override;
+
+private:
+    struct Row {
+        uint32_t sample;
+        uint32_t object;
+        uint64_t objectId;
+        AnalysisResult result;
+    };
+
+    bool intervals;
+    std::vector<Row> rows;
+
+    void writeChunk();
+};
+
+// format is "csv", "ndjson" or "columns" (raw only). 95% intervals are only written for approximate results.
+std::unique_ptr<ResultSink> openSink(const std::string &format, const std::string &path, bool raw, bool intervals);
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// KLL quantile sketch, estimates any quantile of a stream of values in O(k) memory, within about 1.7 / k of the
+// true rank. Values go into level 0, and a level that fills up is sorted and every other value moves up a level,
+// where each one stands for twice as many. Sketches of parts of a stream merge into one of the whole.
+struct QuantileSketch {
+    explicit QuantileSketch(size_t k = 200);
+
+    void add(double value);
+    void merge(const QuantileSketch &other);
+
+    // Values added, whether or not they're still held.
+    uint64_t count() const { return total; }
+
+    // Value at quantile q in [0, 1], zero when empty.
+    double quantile(double q) const;
+
+private:
+    size_t k;
+    uint64_t total = 0;
+
+    // Which half of a compacted level moves up, the same choices every run.
+    uint64_t coin = 0x9E3779B97F4A7C15ull;
+
+    std::vector<std::vector<double>> levels;
+
+    size_t capacity(size_t level) const;
+    size_t size() const;
+
+    void compress();
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <paintings/analysis.h>
+
+#include <string>
+#include <vector>
+#include <shared_mutex>
+
+// Exact analysis results on disk, one fixed size record per object, classifier version and decode scale.
+// The file is memory mapped as an open addressing hash table, so a lookup touches one or two records.
+// Only one process can have a store open at a time.
+struct ResultStore {
+    explicit ResultStore(const std::string &path);
+    ~ResultStore();
+
+    ResultStore(const ResultStore &) = delete;
+    ResultStore &operator=(const ResultStore &) = delete;
+
+    bool find(uint64_t objectId, int32_t scale, AnalysisResult &result) const;
+
+    // Approximate results aren't kept, only exact ones are worth reusing.
+    void insert(uint64_t objectId, int32_t scale, const AnalysisResult &result);
+
+    // Results stored under the current classifier version.
+    size_t size() const;
+
+    // Every result stored under the current classifier version at this scale, in table order, and the object ID of
+    // each into objectIds when given.
+    std::vector<AnalysisResult> results(int32_t scale, std::vector<uint64_t> *objectIds = nullptr) const;
+
+    struct Header;
+    struct Record;
+
+private:
+    std::string path;
+    int file = -1;
+
+    mutable std::shared_mutex mutex;
+
+    Header *header = nullptr;
+    Record *records = nullptr;
+
+    void map(uint64_t capacity);
+    void unmap();
+    void grow();
+
+    Record *slot(uint64_t objectId, int32_t scale) const;
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+struct ThreadPool {
+    explicit ThreadPool(size_t threads);
+    ~ThreadPool();
+
+    // Runs task(0) to task(count - 1) on the pool and the calling thread, returns when all have finished.
+    void run(size_t count, const std::function<void(size_t)> &task);
+
+private:
+    struct Job {
+        const std::function<void(size_t)> &task;
+        const size_t count;
+
+        std::atomic<size_t> next { 0 };
+        std::atomic<size_t> done { 0 };
+
+        Job(const std::function<void(size_t)> &task, size_t count) : task(task), count(count) { }
+    };
+
+    std::mutex mutex;
+    std::condition_variable available;
+    std::condition_variable finished;
+
+    bool stopping = false;
+    std::deque<std::shared_ptr<Job>> jobs;
+    std::vector<std::thread> threads;
+
+    void work(Job &job);
+    void retire(const std::shared_ptr<Job> &job);
+    void workerThread();
+};
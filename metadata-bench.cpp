@@ -0,0 +1,136 @@
+#include <paintings/metadata.h>
+
+#include <nlohmann/json.hpp>
+
+#include <fmt/printf.h>
+
+#include <CLI/App.hpp>
+#include <CLI/Config.hpp>
+#include <CLI/Formatter.hpp>
+
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+using nlohmann::json;
+
+struct Options {
+    std::string input;
+    size_t repeats = 100;
+
+    Options(int count, const char **args) {
+        CLI::App app("Measures how fast object metadata is read, parsed whole against picked out while parsing.");
+
+        app.add_option("-i,--input", input, "Recorded /objects/{id} response or directory of them (.json).")
+            ->required();
+        app.add_option("-n,--repeats", repeats, "How many times each response is parsed per method.");
+
+        try {
+            app.parse(count, args);
+        } catch (const CLI::ParseError &e) {
+            throw std::runtime_error(e.what());
+        }
+    }
+};
+
+// Totals for one method over every response.
+struct Throughput {
+    size_t responses = 0;
+    size_t failures = 0;
+    double bytes = 0;
+    double seconds = 0;
+
+    std::string toString() const {
+        return fmt::format(
+            "Responses: {} ({} failed)\n"
+            "Parse Time: {:.3f}s\n"
+            "Parsed: {:.1f} MB/s\n"
+            "Objects: {:.0f}/s\n",
+            responses, failures,
+            seconds,
+            bytes / 1e6 / std::max(seconds, 1e-9),
+            static_cast<double>(responses) / std::max(seconds, 1e-9));
+    }
+};
+
+// What the sampler did before, the whole document for one field.
+bool parseDocument(const std::vector<uint8_t> &bytes, std::string &primaryImage) {
+    auto obj = json::parse(bytes.begin(), bytes.end(), nullptr, false);
+    if (obj.is_discarded() || !obj.contains("primaryImage") || !obj["primaryImage"].is_string())
+        return false;
+
+    obj["primaryImage"].get_to(primaryImage);
+
+    return true;
+}
+
+template <typename Parse>
+void measure(const std::vector<uint8_t> &bytes, size_t repeats, Throughput &throughput, Parse parse) {
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t a = 0; a < repeats; a++) {
+        throughput.responses++;
+
+        if (!parse())
+            throughput.failures++;
+    }
+
+    throughput.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    throughput.bytes += static_cast<double>(bytes.size()) * static_cast<double>(repeats);
+}
+
+int main(int count, const char **args) {
+    try {
+        Options options(count, args);
+
+        std::vector<fs::path> paths;
+
+        if (fs::is_directory(options.input)) {
+            for (const auto &file : fs::recursive_directory_iterator(options.input)) {
+                if (file.path().extension() == ".json")
+                    paths.push_back(file.path());
+            }
+        } else {
+            paths.emplace_back(options.input);
+        }
+
+        Throughput document, streaming;
+        size_t mismatches = 0;
+
+        for (const fs::path &path : paths) {
+            std::ifstream stream(path, std::ios::binary);
+            std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+            std::string primaryImage;
+            ObjectMetadata metadata;
+
+            measure(bytes, options.repeats, document, [&] {
+                return parseDocument(bytes, primaryImage);
+            });
+
+            measure(bytes, options.repeats, streaming, [&] {
+                metadata = ObjectMetadata();
+                return parseMetadata(bytes.data(), bytes.size(), metadata);
+            });
+
+            // Both have to agree for the comparison to mean anything.
+            if (primaryImage != metadata.primaryImage) {
+                fmt::print("{}: primaryImage differs, \"{}\" against \"{}\"\n",
+                    path.string(), primaryImage, metadata.primaryImage);
+                mismatches++;
+            }
+        }
+
+        fmt::print("Files: {} ({} mismatched)\n", paths.size(), mismatches);
+        fmt::print("\n# json::parse\n{}", document.toString());
+        fmt::print("\n# parseMetadata\n{}", streaming.toString());
+    } catch (const std::runtime_error &e) {
+        fmt::print("{}\n", e.what());
+        return 1;
+    }
+
+    return 0;
+}
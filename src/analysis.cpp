@@ -1,9 +1,14 @@
 #include <paintings/analysis.h>
 
-#include <paintings/colors.h>
+#include <paintings/kernel.h>
+#include <paintings/threads.h>
 
 #include <fmt/format.h>
 
+#include <cmath>
+#include <random>
+#include <algorithm>
+
 std::string join(const std::array<uint64_t, samples.size()> &arr) {
     std::array<std::string, samples.size()> texts;
 
@@ -24,40 +29,135 @@ std::string join(const std::array<double, samples.size()> &arr) {
     return fmt::format("{}", fmt::join(texts, "\n"));
 }
 
+bool AnalysisResult::approximate() const {
+    return std::any_of(upper.begin(), upper.end(), [](double value) { return value > 0; });
+}
+
 std::string AnalysisResult::toString() const {
-    return fmt::format(
+    std::string text = fmt::format(
         "Pixel Count: {}\n"
         "Sample Frequency:\n{}\n"
         "Sample Normalized:\n{}\n",
         numPixels,
         join(sampleFrequency),
         join(normalized));
+
+    if (approximate())
+        text += fmt::format("Sample Lower (95%):\n{}\nSample Upper (95%):\n{}\n", join(lower), join(upper));
+
+    return text;
 }
 
-AnalysisResult::AnalysisResult(const ImageData &image) {
-    numPixels = image.width * image.height;
+// One per band, padded so neighbouring bands don't share a cache line.
+struct alignas(64) Histogram {
+    std::array<uint64_t, samples.size()> counts = { };
+};
+
+AnalysisResult::AnalysisResult(uint64_t numPixels, const std::array<uint64_t, samples.size()> &sampleFrequency)
+    : numPixels(numPixels), sampleFrequency(sampleFrequency) {
+    normalize();
+}
+
+AnalysisResult::AnalysisResult(const ImageData &image, ThreadPool *pool) {
+    numPixels = static_cast<uint64_t>(image.width) * static_cast<uint64_t>(image.height);
+
+    if (!pool || numPixels < splitPixels) {
+        classifyPixels(image.data, numPixels, sampleFrequency.data());
+    } else {
+        size_t width = image.width;
+        size_t height = image.height;
+        size_t bandRows = std::max<size_t>(bandPixels / width, 1);
+        size_t bands = (height + bandRows - 1) / bandRows;
+
+        std::vector<Histogram> histograms(bands);
+
+        pool->run(bands, [&](size_t band) {
+            size_t row = band * bandRows;
+            size_t rows = std::min(bandRows, height - row);
+
+            classifyPixels(image.data + row * width * 3, rows * width, histograms[band].counts.data());
+        });
+
+        for (const Histogram &histogram : histograms) {
+            for (size_t a = 0; a < samples.size(); a++)
+                sampleFrequency[a] += histogram.counts[a];
+        }
+    }
+
+    normalize();
+}
+
+AnalysisResult::AnalysisResult(const ImageData &image, const Approximation &approximation, ThreadPool *pool) {
+    uint64_t total = static_cast<uint64_t>(image.width) * static_cast<uint64_t>(image.height);
 
     const RGB *colors = reinterpret_cast<RGB *>(image.data);
+    const ColorTable<HueColors> &table = ColorTable<HueColors>::get();
+
+    std::mt19937_64 generator(approximation.seed);
+
+    // z for a two sided 95% interval
+    constexpr double z = 1.959964;
 
-    for (uint64_t a = 0; a < numPixels; a++) {
-        const RGB &color = colors[a];
-        HSL hsl(color);
-
-        sampleFrequency[hsl.classify()]++;
-
-//        if (hsl.lightness < 0.03) {
-//            sampleFrequency[6]++; // black
-//        } else if (hsl.lightness > 0.9) {
-//            sampleFrequency[7]++; // white
-//        } else if (hsl.saturation < 0.15) {
-//            sampleFrequency[8]++; // gray
-//        } else {
-//            size_t index = std::fmod(hsl.hue + 30.0, 360.0) / 60.0;
-//
-//            sampleFrequency[index]++;
-//        }
+    for (uint64_t strata = std::max<uint64_t>(approximation.strata, 1); ; strata *= 2) {
+        if (numPixels + strata > total / 4) {
+            *this = AnalysisResult(image, pool);
+            return;
+        }
+
+        for (uint64_t a = 0; a < strata; a++) {
+            uint64_t begin = a * total / strata;
+            uint64_t end = (a + 1) * total / strata;
+
+            std::uniform_int_distribution<uint64_t> distribution(begin, end - 1);
+
+            sampleFrequency[table.classify(colors[distribution(generator)])]++;
+        }
+
+        numPixels += strata;
+
+        // Wilson score interval, on the conservative side for a stratified draw.
+        double n = static_cast<double>(numPixels);
+        double widest = 0;
+
+        for (size_t a = 0; a < samples.size(); a++) {
+            double p = static_cast<double>(sampleFrequency[a]) / n;
+
+            double center = (p + z * z / (2 * n)) / (1 + z * z / n);
+            double half = z / (1 + z * z / n) * std::sqrt(p * (1 - p) / n + z * z / (4 * n * n));
+
+            lower[a] = std::max(center - half, 0.0);
+            upper[a] = std::min(center + half, 1.0);
+            widest = std::max(widest, upper[a] - lower[a]);
+        }
+
+        if (widest < approximation.width)
+            break;
     }
 
+    normalize();
+}
+
+AnalysisResult::AnalysisResult(ImageReader &reader) {
+    size_t width = reader.width;
+
+    if (width == 0)
+        return;
+
+    // Reused by every image on this thread, so it only ever grows to a few rows of the widest one.
+    thread_local std::vector<uint8_t> buffer;
+
+    size_t rows = std::max<size_t>(streamPixels / width, 1);
+    buffer.resize(rows * width * 3);
+
+    for (size_t count = reader.read(buffer.data(), rows); count > 0; count = reader.read(buffer.data(), rows)) {
+        classifyPixels(buffer.data(), count * width, sampleFrequency.data());
+        numPixels += count * width;
+    }
+
+    normalize();
+}
+
+void AnalysisResult::normalize() {
     auto normalize = [this](uint64_t i) {
         return static_cast<double>(i) / static_cast<double>(numPixels);
     };
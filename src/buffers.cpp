@@ -0,0 +1,145 @@
+#include <paintings/buffers.h>
+
+#include <fmt/format.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+// Each block starts with its capacity, padded so the data after it stays 64 byte aligned for the kernels.
+static constexpr size_t headerSize = 64;
+
+static size_t &capacityOf(uint8_t *data) {
+    return *reinterpret_cast<size_t *>(data - headerSize);
+}
+
+// Rounds a pooled size up to its class, returns the class index and the rounded size.
+static size_t sizeClass(size_t size, size_t &rounded) {
+    size_t exponent = 63 - __builtin_clzll(size - 1);
+    size_t step = size_t(1) << (exponent - 2);
+
+    rounded = (size + step - 1) & ~(step - 1);
+
+    return exponent * 4 + ((rounded - 1) >> (exponent - 2) & 3);
+}
+
+std::string BufferPool::Stats::toString() const {
+    uint64_t total = std::max<uint64_t>(hits + misses, 1);
+
+    return fmt::format("Buffer Pool: {} hits, {} misses ({:.1f}% reused), {} dropped, {:.1f} MiB retained",
+        hits, misses, 100.0 * hits / total, dropped, retainedBytes / (1024.0 * 1024.0));
+}
+
+BufferPool::BufferPool(size_t capacity) : capacity(capacity), lists(64 * classesPerDoubling) { }
+
+BufferPool::~BufferPool() {
+    for (auto &list : lists) {
+        for (uint8_t *data : list)
+            std::free(data - headerSize);
+    }
+}
+
+uint8_t *BufferPool::acquire(size_t size) {
+    size_t rounded = size;
+
+    if (size >= pooledSize) {
+        size_t index = sizeClass(size, rounded);
+
+        std::lock_guard lock(mutex);
+
+        if (!lists[index].empty()) {
+            uint8_t *data = lists[index].back();
+            lists[index].pop_back();
+
+            counters.hits++;
+            counters.retainedBytes -= rounded;
+
+            return data;
+        }
+
+        counters.misses++;
+    }
+
+    void *block = std::aligned_alloc(headerSize, headerSize + ((rounded + headerSize - 1) & ~(headerSize - 1)));
+    if (!block)
+        return nullptr;
+
+    uint8_t *data = static_cast<uint8_t *>(block) + headerSize;
+    capacityOf(data) = rounded;
+
+    return data;
+}
+
+uint8_t *BufferPool::resize(uint8_t *data, size_t size) {
+    if (!data)
+        return acquire(size);
+
+    size_t capacity = capacityOf(data);
+    if (size <= capacity)
+        return data;
+
+    uint8_t *grown = acquire(size);
+    if (!grown)
+        return nullptr;
+
+    std::memcpy(grown, data, capacity);
+    release(data);
+
+    return grown;
+}
+
+void BufferPool::release(uint8_t *data) {
+    if (!data)
+        return;
+
+    size_t size = capacityOf(data);
+
+    if (size >= pooledSize) {
+        size_t rounded;
+        size_t index = sizeClass(size, rounded);
+
+        std::lock_guard lock(mutex);
+
+        if (counters.retainedBytes + size <= capacity) {
+            lists[index].push_back(data);
+            counters.retainedBytes += size;
+
+            return;
+        }
+
+        counters.dropped++;
+    }
+
+    std::free(data - headerSize);
+}
+
+void BufferPool::setCapacity(size_t bytes) {
+    std::lock_guard lock(mutex);
+
+    capacity = bytes;
+
+    // Drops the largest buffers first until the rest fits.
+    for (size_t index = lists.size(); index-- > 0 && counters.retainedBytes > capacity;) {
+        while (!lists[index].empty() && counters.retainedBytes > capacity) {
+            uint8_t *data = lists[index].back();
+            lists[index].pop_back();
+
+            counters.retainedBytes -= capacityOf(data);
+            counters.dropped++;
+
+            std::free(data - headerSize);
+        }
+    }
+}
+
+BufferPool::Stats BufferPool::stats() const {
+    std::lock_guard lock(mutex);
+
+    return counters;
+}
+
+BufferPool &BufferPool::global() {
+    static BufferPool pool(512 * 1024 * 1024);
+
+    return pool;
+}
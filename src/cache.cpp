@@ -0,0 +1,190 @@
+#include <paintings/cache.h>
+
+#include <fmt/format.h>
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+// FNV-1a, only has to spread keys over file names.
+static uint64_t hashKey(uint64_t objectId, const std::string &url) {
+    uint64_t hash = 14695981039346656037ull;
+
+    auto mix = [&hash](const void *data, size_t size) {
+        for (size_t a = 0; a < size; a++) {
+            hash ^= static_cast<const uint8_t *>(data)[a];
+            hash *= 1099511628211ull;
+        }
+    };
+
+    mix(&objectId, sizeof(objectId));
+    mix(url.data(), url.size());
+
+    return hash;
+}
+
+// Temporary files younger than this are another store still writing, older ones were left by a process that died.
+static constexpr auto temporaryGrace = std::chrono::hours(1);
+
+DiskCache::DiskCache(const fs::path &directory, uint64_t capacity) : directory(directory), capacity(capacity) {
+    fs::create_directories(directory);
+
+    // The first pass measures what earlier runs left.
+    requested = true;
+    evictor = std::thread([this] { evictThread(); });
+}
+
+DiskCache::~DiskCache() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+
+    evictions.notify_all();
+    evictor.join();
+}
+
+fs::path DiskCache::pathFor(uint64_t objectId, const std::string &url) const {
+    std::string name = fmt::format("{:016x}", hashKey(objectId, url));
+
+    // Split over 256 subdirectories so none of them holds the whole collection.
+    return directory / name.substr(0, 2) / name;
+}
+
+bool DiskCache::load(uint64_t objectId, const std::string &url, std::vector<uint8_t> &data) {
+    fs::path path = pathFor(objectId, url);
+
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream)
+        return false;
+
+    data.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    if (stream.bad() || data.empty())
+        return false;
+
+    // Modification time doubles as the last use for eviction.
+    std::error_code error;
+    fs::last_write_time(path, fs::file_time_type::clock::now(), error);
+
+    return true;
+}
+
+void DiskCache::store(uint64_t objectId, const std::string &url, const std::vector<uint8_t> &data) {
+    static std::atomic<uint64_t> counter { 0 };
+
+    fs::path path = pathFor(objectId, url);
+    fs::path temporary = path;
+    temporary += fmt::format(".{}.{}.tmp", getpid(), counter++);
+
+    std::error_code error;
+    fs::create_directories(path.parent_path(), error);
+
+    {
+        std::ofstream stream(temporary, std::ios::binary);
+        stream.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+
+        if (!stream) {
+            fs::remove(temporary, error);
+            return;
+        }
+    }
+
+    fs::rename(temporary, path, error);
+    if (error) {
+        fs::remove(temporary, error);
+        return;
+    }
+
+    {
+        std::lock_guard lock(mutex);
+
+        size += data.size();
+        written += data.size();
+
+        if (size <= capacity || requested || evicting)
+            return;
+
+        requested = true;
+    }
+
+    evictions.notify_all();
+}
+
+void DiskCache::evictThread() {
+    std::unique_lock lock(mutex);
+
+    while (true) {
+        evictions.wait(lock, [this] { return stopping || requested; });
+
+        if (stopping)
+            return;
+
+        requested = false;
+        evicting = true;
+        written = 0;
+
+        lock.unlock();
+        uint64_t total = evict();
+        lock.lock();
+
+        size = total + written;
+        evicting = false;
+    }
+}
+
+uint64_t DiskCache::evict() {
+    struct Entry {
+        fs::path path;
+        fs::file_time_type used;
+        uint64_t size;
+    };
+
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+
+    std::error_code error;
+    auto now = fs::file_time_type::clock::now();
+
+    for (auto it = fs::recursive_directory_iterator(directory, error); !error && it != fs::end(it); it.increment(error)) {
+        std::error_code entryError;
+
+        if (!it->is_regular_file(entryError))
+            continue;
+
+        Entry entry { it->path(), it->last_write_time(entryError), it->file_size(entryError) };
+        if (entryError)
+            continue;
+
+        if (entry.path.extension() == ".tmp" && now - entry.used < temporaryGrace)
+            continue;
+
+        total += entry.size;
+        entries.push_back(std::move(entry));
+    }
+
+    // Down to 90% so the next few stores don't trigger another scan straight away.
+    if (total > capacity) {
+        std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+            return a.used < b.used;
+        });
+
+        uint64_t target = capacity / 10 * 9;
+
+        for (const Entry &entry : entries) {
+            if (total <= target)
+                break;
+
+            // Another process may have evicted it already, either way it's gone.
+            fs::remove(entry.path, error);
+            total -= entry.size;
+        }
+    }
+
+    return total;
+}
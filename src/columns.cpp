@@ -0,0 +1,111 @@
+#include <paintings/columns.h>
+
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static_assert(sizeof(ColumnFile::Header) == 32);
+static_assert(sizeof(ColumnFile::ChunkHeader) == 16);
+
+static uint64_t padded(uint64_t bytes) {
+    return (bytes + 7) & ~uint64_t(7);
+}
+
+uint64_t ColumnFile::chunkBytes(size_t rows, size_t classes, bool intervals) {
+    uint64_t narrow = padded(rows * sizeof(uint32_t));
+    uint64_t wide = rows * sizeof(uint64_t);
+
+    return 2 * narrow + (2 + classes * (intervals ? 3 : 1)) * wide;
+}
+
+ColumnFile::ColumnFile(const std::string &path) {
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+        throw std::runtime_error("Could not open column file at \"" + path + "\".");
+
+    struct stat info;
+    if (fstat(file, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(Header)) {
+        close(file);
+        throw std::runtime_error("\"" + path + "\" is not a column file.");
+    }
+
+    size = static_cast<size_t>(info.st_size);
+
+    void *memory = mmap(nullptr, size, PROT_READ, MAP_SHARED, file, 0);
+    close(file);
+
+    if (memory == MAP_FAILED)
+        throw std::runtime_error("Could not map column file at \"" + path + "\".");
+
+    data = static_cast<const uint8_t *>(memory);
+
+    // Chunks are scanned front to back once they're found.
+    madvise(memory, size, MADV_SEQUENTIAL);
+
+    Header header;
+    std::memcpy(&header, data, sizeof(header));
+
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.format != format
+        || size < sizeof(Header) + header.classes * nameSize) {
+        munmap(memory, size);
+        throw std::runtime_error("\"" + path + "\" is not a column file.");
+    }
+
+    intervals = header.flags & intervalFlag;
+
+    const char *names = reinterpret_cast<const char *>(data + sizeof(Header));
+
+    for (uint32_t a = 0; a < header.classes; a++)
+        classes.emplace_back(names + a * nameSize, strnlen(names + a * nameSize, nameSize));
+
+    uint64_t offset = sizeof(Header) + padded(header.classes * nameSize);
+
+    while (offset + sizeof(ChunkHeader) <= size) {
+        ChunkHeader chunkHeader;
+        std::memcpy(&chunkHeader, data + offset, sizeof(chunkHeader));
+
+        uint64_t bytes = chunkBytes(chunkHeader.rows, classes.size(), intervals);
+
+        // Cut short, or not a chunk at all, either way the end of what's usable.
+        if (std::memcmp(chunkHeader.magic, chunkMagic, sizeof(chunkMagic)) != 0 || chunkHeader.bytes != bytes
+            || offset + sizeof(ChunkHeader) + bytes > size)
+            break;
+
+        const uint8_t *column = data + offset + sizeof(ChunkHeader);
+
+        auto next = [&column](uint64_t bytes) {
+            const uint8_t *start = column;
+            column += padded(bytes);
+
+            return start;
+        };
+
+        Chunk &chunk = chunks.emplace_back();
+        chunk.rows = chunkHeader.rows;
+        chunk.sample = reinterpret_cast<const uint32_t *>(next(chunk.rows * sizeof(uint32_t)));
+        chunk.object = reinterpret_cast<const uint32_t *>(next(chunk.rows * sizeof(uint32_t)));
+        chunk.objectId = reinterpret_cast<const uint64_t *>(next(chunk.rows * sizeof(uint64_t)));
+        chunk.numPixels = reinterpret_cast<const uint64_t *>(next(chunk.rows * sizeof(uint64_t)));
+
+        for (size_t a = 0; a < classes.size(); a++)
+            chunk.frequency.push_back(reinterpret_cast<const uint64_t *>(next(chunk.rows * sizeof(uint64_t))));
+
+        if (intervals) {
+            for (size_t a = 0; a < classes.size(); a++)
+                chunk.lower.push_back(reinterpret_cast<const double *>(next(chunk.rows * sizeof(double))));
+            for (size_t a = 0; a < classes.size(); a++)
+                chunk.upper.push_back(reinterpret_cast<const double *>(next(chunk.rows * sizeof(double))));
+        }
+
+        rows += chunk.rows;
+        offset += sizeof(ChunkHeader) + bytes;
+    }
+}
+
+ColumnFile::~ColumnFile() {
+    munmap(const_cast<uint8_t *>(data), size);
+}
@@ -0,0 +1,342 @@
+#include <paintings/decoder.h>
+
+#include <stb_image.h>
+
+#ifdef PAINTINGS_JPEG
+#include <cstdio>
+#include <csetjmp>
+#include <jpeglib.h>
+#endif
+
+#ifdef PAINTINGS_PNG
+#include <png.h>
+#endif
+
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+// Averages `rows` consecutive source rows (fewer than scale at the bottom edge) in scale x scale blocks,
+// clipped at the right edge, into one output row.
+static void shrinkRows(const uint8_t *source, size_t sourceWidth, size_t rows, size_t scale, uint8_t *output) {
+    size_t width = (sourceWidth + scale - 1) / scale;
+
+    for (size_t x = 0; x < width; x++) {
+        size_t left = x * scale;
+        size_t right = std::min(left + scale, sourceWidth);
+
+        uint32_t sums[3] = { };
+
+        for (size_t y = 0; y < rows; y++) {
+            const uint8_t *pixel = source + (y * sourceWidth + left) * 3;
+
+            for (size_t a = 0; a < (right - left) * 3; a++)
+                sums[a % 3] += pixel[a];
+        }
+
+        auto count = static_cast<uint32_t>(rows * (right - left));
+
+        for (size_t a = 0; a < 3; a++)
+            output[x * 3 + a] = static_cast<uint8_t>((sums[a] + count / 2) / count);
+    }
+}
+
+struct BufferReader : public ImageReader {
+    // Decoded straight through stb_image, ImageData would ask the decoders again.
+    uint8_t *data = nullptr;
+    size_t sourceWidth = 0;
+    size_t sourceHeight = 0;
+
+    size_t scale = 1;
+    size_t row = 0;
+
+    size_t read(uint8_t *rows, size_t count) override {
+        count = std::min(count, static_cast<size_t>(height) - row);
+
+        size_t stride = static_cast<size_t>(width) * 3;
+
+        if (scale == 1) {
+            std::memcpy(rows, data + row * stride, count * stride);
+        } else {
+            for (size_t a = 0; a < count; a++) {
+                size_t top = (row + a) * scale;
+                size_t bottom = std::min(top + scale, sourceHeight);
+
+                shrinkRows(data + top * sourceWidth * 3, sourceWidth, bottom - top, scale, rows + a * stride);
+            }
+        }
+
+        row += count;
+
+        return count;
+    }
+
+    BufferReader(const uint8_t *input, size_t size, int32_t scale) : scale(scale) {
+        int32_t imageWidth, imageHeight;
+        data = stbi_load_from_memory(input, size, &imageWidth, &imageHeight, nullptr, 3);
+
+        if (!data)
+            throw std::runtime_error("Something went horribly wrong...");
+
+        sourceWidth = imageWidth;
+        sourceHeight = imageHeight;
+        width = (imageWidth + scale - 1) / scale;
+        height = (imageHeight + scale - 1) / scale;
+    }
+
+    ~BufferReader() override {
+        stbi_image_free(data);
+    }
+};
+
+struct StbDecoder : public Decoder {
+    const char *name() const override {
+        return "stb";
+    }
+
+    bool accepts(const uint8_t *, size_t) const override {
+        return true;
+    }
+
+    std::unique_ptr<ImageReader> open(const uint8_t *input, size_t size, int32_t scale) const override {
+        return std::make_unique<BufferReader>(input, size, scale);
+    }
+};
+
+#ifdef PAINTINGS_JPEG
+
+struct JpegReader : public ImageReader {
+    // libjpeg reports errors through error_exit, which must not return, so it jumps back into whichever
+    // call is running and that call throws.
+    struct Error {
+        jpeg_error_mgr manager = { };
+        jmp_buf jump = { };
+    };
+
+    Error error;
+    jpeg_decompress_struct info = { };
+
+    size_t read(uint8_t *rows, size_t count) override {
+        if (setjmp(error.jump))
+            throw std::runtime_error("Failed to decode JPEG scanlines.");
+
+        size_t done = 0;
+
+        while (done < count && info.output_scanline < info.output_height) {
+            JSAMPROW row = rows + done * width * 3;
+            done += jpeg_read_scanlines(&info, &row, 1);
+        }
+
+        return done;
+    }
+
+    JpegReader(const uint8_t *input, size_t size, int32_t scale) {
+        info.err = jpeg_std_error(&error.manager);
+        error.manager.error_exit = [](j_common_ptr common) {
+            longjmp(reinterpret_cast<Error *>(common->err)->jump, 1);
+        };
+        error.manager.output_message = [](j_common_ptr) { };
+
+        jpeg_create_decompress(&info);
+
+        if (setjmp(error.jump)) {
+            jpeg_destroy_decompress(&info);
+            throw std::runtime_error("Failed to start JPEG decode.");
+        }
+
+        jpeg_mem_src(&info, const_cast<uint8_t *>(input), size);
+        jpeg_read_header(&info, TRUE);
+
+        // DCT scaling, so smaller decodes skip most of the IDCT work.
+        info.out_color_space = JCS_RGB;
+        info.scale_num = 1;
+        info.scale_denom = scale;
+        jpeg_start_decompress(&info);
+
+        width = info.output_width;
+        height = info.output_height;
+    }
+
+    ~JpegReader() override {
+        jpeg_destroy_decompress(&info);
+    }
+};
+
+struct JpegDecoder : public Decoder {
+    const char *name() const override {
+#ifdef LIBJPEG_TURBO_VERSION
+        return "libjpeg-turbo";
+#else
+        return "libjpeg";
+#endif
+    }
+
+    bool accepts(const uint8_t *input, size_t size) const override {
+        return size >= 3 && input[0] == 0xFF && input[1] == 0xD8 && input[2] == 0xFF;
+    }
+
+    std::unique_ptr<ImageReader> open(const uint8_t *input, size_t size, int32_t scale) const override {
+        return std::make_unique<JpegReader>(input, size, scale);
+    }
+};
+
+#endif
+
+#ifdef PAINTINGS_PNG
+
+struct PngReader : public ImageReader {
+    png_structp png = nullptr;
+    png_infop info = nullptr;
+
+    const uint8_t *input = nullptr;
+    size_t size = 0;
+    size_t offset = 0;
+
+    size_t scale = 1;
+    size_t sourceWidth = 0;
+    size_t sourceHeight = 0;
+    size_t sourceRow = 0;
+
+    // The scale source rows being averaged into the next output row.
+    std::vector<uint8_t> block;
+
+    size_t read(uint8_t *rows, size_t count) override {
+        if (setjmp(png_jmpbuf(png)))
+            throw std::runtime_error("Failed to decode PNG rows.");
+
+        size_t done = 0;
+        size_t stride = static_cast<size_t>(width) * 3;
+
+        while (done < count && sourceRow < sourceHeight) {
+            if (scale == 1) {
+                png_read_row(png, rows + done * stride, nullptr);
+                sourceRow++;
+            } else {
+                size_t take = std::min(scale, sourceHeight - sourceRow);
+
+                for (size_t a = 0; a < take; a++)
+                    png_read_row(png, block.data() + a * sourceWidth * 3, nullptr);
+
+                shrinkRows(block.data(), sourceWidth, take, scale, rows + done * stride);
+                sourceRow += take;
+            }
+
+            done++;
+        }
+
+        return done;
+    }
+
+    PngReader(const uint8_t *input, size_t size, int32_t scale) : input(input), size(size), scale(scale) {
+        png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr,
+            [](png_structp png, png_const_charp) { png_longjmp(png, 1); },
+            [](png_structp, png_const_charp) { });
+
+        if (!png)
+            throw std::runtime_error("Failed to create PNG decoder.");
+
+        info = png_create_info_struct(png);
+
+        if (!info || setjmp(png_jmpbuf(png))) {
+            png_destroy_read_struct(&png, &info, nullptr);
+            throw std::runtime_error("Failed to start PNG decode.");
+        }
+
+        png_set_read_fn(png, this, [](png_structp png, png_bytep data, png_size_t length) {
+            auto *reader = static_cast<PngReader *>(png_get_io_ptr(png));
+
+            if (length > reader->size - reader->offset)
+                png_error(png, "Truncated PNG.");
+
+            std::memcpy(data, reader->input + reader->offset, length);
+            reader->offset += length;
+        });
+
+        png_read_info(png, info);
+
+        // Interlaced rows come in seven passes, leave those to stb_image.
+        if (png_get_interlace_type(png, info) != PNG_INTERLACE_NONE)
+            png_error(png, "Interlaced PNG.");
+
+        // Same conversions as stb_image asked for 3 channels.
+        png_set_expand(png);
+        png_set_strip_16(png);
+        png_set_strip_alpha(png);
+        png_set_gray_to_rgb(png);
+        png_read_update_info(png, info);
+
+        sourceWidth = png_get_image_width(png, info);
+        sourceHeight = png_get_image_height(png, info);
+
+        if (png_get_rowbytes(png, info) != sourceWidth * 3)
+            png_error(png, "Unexpected PNG row layout.");
+
+        width = (sourceWidth + scale - 1) / scale;
+        height = (sourceHeight + scale - 1) / scale;
+
+        if (scale > 1)
+            block.resize(sourceWidth * 3 * scale);
+    }
+
+    ~PngReader() override {
+        png_destroy_read_struct(&png, &info, nullptr);
+    }
+};
+
+struct PngDecoder : public Decoder {
+    const char *name() const override {
+        return "libpng";
+    }
+
+    bool accepts(const uint8_t *input, size_t size) const override {
+        return size >= 8 && png_sig_cmp(input, 0, 8) == 0;
+    }
+
+    std::unique_ptr<ImageReader> open(const uint8_t *input, size_t size, int32_t scale) const override {
+        return std::make_unique<PngReader>(input, size, scale);
+    }
+};
+
+#endif
+
+const std::vector<const Decoder *> &decoders() {
+#ifdef PAINTINGS_JPEG
+    static const JpegDecoder jpeg;
+#endif
+#ifdef PAINTINGS_PNG
+    static const PngDecoder png;
+#endif
+    static const StbDecoder stb;
+
+    static const std::vector<const Decoder *> list = {
+#ifdef PAINTINGS_JPEG
+        &jpeg,
+#endif
+#ifdef PAINTINGS_PNG
+        &png,
+#endif
+        &stb,
+    };
+
+    return list;
+}
+
+std::unique_ptr<ImageReader> ImageReader::open(const uint8_t *input, size_t size, int32_t scale) {
+    if (!validDecodeScale(scale))
+        throw std::runtime_error("Decode scale has to be 1, 2, 4 or 8.");
+
+    // A backend can turn down data it accepted (CMYK JPEGs, interlaced PNGs), the next one gets a try.
+    for (const Decoder *decoder : decoders()) {
+        if (!decoder->accepts(input, size))
+            continue;
+
+        try {
+            return decoder->open(input, size, scale);
+        } catch (const std::runtime_error &) {
+            if (decoder == decoders().back())
+                throw;
+        }
+    }
+
+    throw std::runtime_error("No decoder for image.");
+}
@@ -0,0 +1,294 @@
+#include <paintings/download.h>
+
+#include <memory>
+#include <charconv>
+#include <algorithm>
+#include <strings.h>
+#include <stdexcept>
+
+static size_t append(char *data, size_t, size_t size, void *user) {
+    auto *body = static_cast<std::vector<uint8_t> *>(user);
+    body->insert(body->end(), data, data + size);
+
+    return size;
+}
+
+static size_t appendHeader(char *data, size_t, size_t size, void *user) {
+    auto *headers = static_cast<std::vector<std::string> *>(user);
+
+    std::string line(data, size);
+    while (!line.empty() && (line.back() == '\n' || line.back() == '\r'))
+        line.pop_back();
+
+    // Every response (redirects, 100 Continue) starts over with a status line, only the last one counts.
+    if (line.compare(0, 5, "HTTP/") == 0)
+        headers->clear();
+    else if (!line.empty())
+        headers->push_back(std::move(line));
+
+    return size;
+}
+
+std::string Downloader::Response::header(const std::string &name) const {
+    for (const std::string &line : headers) {
+        if (line.size() > name.size() && line[name.size()] == ':'
+            && strncasecmp(line.c_str(), name.c_str(), name.size()) == 0) {
+            size_t start = line.find_first_not_of(" \t", name.size() + 1);
+
+            return start == std::string::npos ? std::string() : line.substr(start);
+        }
+    }
+
+    return { };
+}
+
+// Whether a failure is the server shedding load, which calls for slowing down and trying again later.
+static RateController::Outcome classify(CURLcode error, long status) {
+    if (error == CURLE_OK)
+        return RateController::Outcome::Success;
+
+    if (error == CURLE_OPERATION_TIMEDOUT)
+        return RateController::Outcome::Throttled;
+
+    if (error == CURLE_HTTP_RETURNED_ERROR && (status == 403 || status == 429 || status >= 500))
+        return RateController::Outcome::Throttled;
+
+    return RateController::Outcome::Failed;
+}
+
+Downloader::Downloader(const RateController::Settings &settings) : controller(settings) {
+    size_t connections = controller.settings().maximum;
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+
+    multi = curl_multi_init();
+    share = curl_share_init();
+
+    if (!multi || !share)
+        throw std::runtime_error("Failed to set up curl.");
+
+    // Only the download thread uses these handles, so the share needs no lock callbacks.
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+
+    curl_multi_setopt(multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, static_cast<long>(connections));
+    curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, static_cast<long>(connections));
+    curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS, static_cast<long>(connections));
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+
+    thread = std::thread(&Downloader::downloadThread, this);
+}
+
+Downloader::~Downloader() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+
+    curl_multi_wakeup(multi);
+    thread.join();
+
+    for (CURL *handle : idle)
+        curl_easy_cleanup(handle);
+
+    curl_multi_cleanup(multi);
+    curl_share_cleanup(share);
+}
+
+void Downloader::get(const std::string &url, Callback done) {
+    get(url, { }, std::move(done));
+}
+
+std::future<Downloader::Response> Downloader::get(const std::string &url) {
+    return get(url, std::vector<std::string>());
+}
+
+void Downloader::get(const std::string &url, std::vector<std::string> headers, Callback done) {
+    auto transfer = std::make_unique<Transfer>();
+    transfer->response.url = url;
+    transfer->done = std::move(done);
+    transfer->headers = std::move(headers);
+
+    {
+        std::lock_guard lock(mutex);
+
+        if (stopping)
+            throw std::runtime_error("Downloader is shutting down.");
+
+        queued.push_back(transfer.release());
+    }
+
+    curl_multi_wakeup(multi);
+}
+
+RateController::Stats Downloader::stats() {
+    std::lock_guard lock(mutex);
+
+    return controller.stats();
+}
+
+std::future<Downloader::Response> Downloader::get(const std::string &url, std::vector<std::string> headers) {
+    auto promise = std::make_shared<std::promise<Response>>();
+
+    get(url, std::move(headers), [promise](Response &&response) {
+        promise->set_value(std::move(response));
+    });
+
+    return promise->get_future();
+}
+
+void Downloader::start(Transfer *transfer) {
+    CURL *handle;
+
+    if (idle.empty()) {
+        handle = curl_easy_init();
+    } else {
+        handle = idle.back();
+        idle.pop_back();
+
+        curl_easy_reset(handle);
+    }
+
+    curl_easy_setopt(handle, CURLOPT_URL, transfer->response.url.c_str());
+    curl_easy_setopt(handle, CURLOPT_PRIVATE, transfer);
+    curl_easy_setopt(handle, CURLOPT_SHARE, share);
+    curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, append);
+    curl_easy_setopt(handle, CURLOPT_WRITEDATA, &transfer->response.body);
+    curl_easy_setopt(handle, CURLOPT_FAILONERROR, 1L);
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(handle, CURLOPT_PIPEWAIT, 1L);
+    curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT, 10L);
+
+    // A transfer stalled for half a minute counts as a timeout, large images may still take longer than that.
+    curl_easy_setopt(handle, CURLOPT_LOW_SPEED_LIMIT, 1L);
+    curl_easy_setopt(handle, CURLOPT_LOW_SPEED_TIME, 30L);
+    curl_easy_setopt(handle, CURLOPT_ACCEPT_ENCODING, "");
+    curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, appendHeader);
+    curl_easy_setopt(handle, CURLOPT_HEADERDATA, &transfer->response.headers);
+
+    for (const std::string &header : transfer->headers)
+        transfer->headerList = curl_slist_append(transfer->headerList, header.c_str());
+
+    if (transfer->headerList)
+        curl_easy_setopt(handle, CURLOPT_HTTPHEADER, transfer->headerList);
+
+    curl_multi_add_handle(multi, handle);
+    active++;
+}
+
+void Downloader::finish(CURL *handle, CURLcode error) {
+    Transfer *transfer;
+    curl_easy_getinfo(handle, CURLINFO_PRIVATE, &transfer);
+    curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &transfer->response.status);
+
+    curl_off_t firstByte = 0;
+    curl_easy_getinfo(handle, CURLINFO_STARTTRANSFER_TIME_T, &firstByte);
+
+    curl_multi_remove_handle(multi, handle);
+    idle.push_back(handle);
+    active--;
+
+    curl_slist_free_all(transfer->headerList);
+    transfer->headerList = nullptr;
+
+    RateController::Outcome outcome = classify(error, transfer->response.status);
+
+    bool retry;
+
+    {
+        std::lock_guard lock(mutex);
+
+        controller.complete(outcome, std::chrono::microseconds(firstByte));
+        retry = outcome == RateController::Outcome::Throttled && transfer->attempts < controller.settings().retries
+            && !stopping;
+
+        if (retry) {
+            RateController::Clock::duration delay = controller.retryDelay(transfer->attempts);
+
+            // Retry-After in seconds, the date form is rare enough to fall back to the usual delay. Digits that
+            // overflow count as too long, so the header can't throw on this thread.
+            std::string after = transfer->response.header("Retry-After");
+            std::chrono::seconds longest = controller.settings().maxRetryAfter;
+            uint64_t seconds = 0;
+
+            auto [end, parsed] = std::from_chars(after.data(), after.data() + after.size(), seconds);
+
+            if (!after.empty() && end == after.data() + after.size()) {
+                if (parsed == std::errc::result_out_of_range
+                    || seconds > static_cast<uint64_t>(longest.count()))
+                    delay = std::max<RateController::Clock::duration>(delay, longest);
+                else if (parsed == std::errc())
+                    delay = std::max<RateController::Clock::duration>(delay, std::chrono::seconds(seconds));
+            }
+
+            transfer->attempts++;
+            transfer->due = RateController::Clock::now() + delay;
+        }
+    }
+
+    if (retry) {
+        transfer->response.status = 0;
+        transfer->response.body.clear();
+        transfer->response.headers.clear();
+
+        delayed.push_back(transfer);
+        return;
+    }
+
+    transfer->response.error = error;
+
+    std::unique_ptr<Transfer> owned(transfer);
+    owned->done(std::move(owned->response));
+}
+
+void Downloader::downloadThread() {
+    while (true) {
+        auto now = RateController::Clock::now();
+        auto timeout = std::chrono::milliseconds(1000);
+
+        {
+            std::lock_guard lock(mutex);
+
+            // Stopping still lets everything queued finish, callers may be waiting on it.
+            if (stopping && queued.empty() && delayed.empty() && active == 0)
+                return;
+
+            // Retries whose delay is up go ahead of new requests, they've waited longest.
+            for (auto it = delayed.begin(); it != delayed.end();) {
+                if ((*it)->due <= now) {
+                    queued.push_front(*it);
+                    it = delayed.erase(it);
+                } else {
+                    timeout = std::min(timeout, std::chrono::ceil<std::chrono::milliseconds>((*it)->due - now));
+                    it++;
+                }
+            }
+
+            while (!queued.empty() && controller.admit(active, now)) {
+                start(queued.front());
+                queued.pop_front();
+            }
+
+            // Nothing wakes the poll when the rate ceiling frees up, unlike a transfer finishing.
+            if (!queued.empty())
+                timeout = std::min(timeout, std::chrono::ceil<std::chrono::milliseconds>(controller.wait(now)));
+        }
+
+        int running;
+        curl_multi_perform(multi, &running);
+
+        // A finished transfer may make room for a queued one, which shouldn't have to wait out the poll.
+        bool finished = false;
+
+        int left;
+        while (CURLMsg *message = curl_multi_info_read(multi, &left)) {
+            if (message->msg == CURLMSG_DONE) {
+                finish(message->easy_handle, message->data.result);
+                finished = true;
+            }
+        }
+
+        if (!finished)
+            curl_multi_poll(multi, nullptr, 0, static_cast<int>(timeout.count()), nullptr);
+    }
+}
@@ -0,0 +1,48 @@
+#include <paintings/files.h>
+
+#include <CLI/App.hpp>
+#include <CLI/Config.hpp>
+#include <CLI/Formatter.hpp>
+
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+std::vector<fs::path> imageFiles(const std::string &input) {
+    if (!fs::exists(input))
+        throw std::runtime_error("Could not find file or directory at \"" + input + "\".");
+
+    if (!fs::is_directory(input))
+        return { input };
+
+    std::vector<fs::path> paths;
+
+    for (const auto &file : fs::recursive_directory_iterator(input)) {
+        fs::path extension = file.path().extension();
+
+        if (!file.is_directory() && (extension == ".jpg" || extension == ".jpeg" || extension == ".png"))
+            paths.push_back(file.path());
+    }
+
+    return paths;
+}
+
+std::vector<uint8_t> readFile(const fs::path &path) {
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream)
+        throw std::runtime_error("Could not open \"" + path.string() + "\".");
+
+    return std::vector<uint8_t>((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+}
+
+void parseImageOptions(CLI::App &app, std::string &input, int count, const char **args) {
+    app.add_option("input,-i,--input", input, "Image file or directory of images.")->required();
+
+    try {
+        app.parse(count, args);
+    } catch (const CLI::ParseError &e) {
+        throw std::runtime_error(e.what());
+    }
+}
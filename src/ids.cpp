@@ -0,0 +1,306 @@
+#include <paintings/ids.h>
+
+#include <nlohmann/json.hpp>
+
+#include <fmt/format.h>
+
+#include <cctype>
+#include <limits>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <cstring>
+#include <iterator>
+#include <charconv>
+#include <stdexcept>
+
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+using nlohmann::json;
+
+namespace {
+    // Keeps the numbers of the top level objectIDs array and skips over everything else. The top level total
+    // comes first in responses, so the list can be reserved up front, up to a cap that a bogus total can't
+    // turn into a bad_alloc. The list grows past it as usual.
+    struct IdHandler : nlohmann::json_sax<json> {
+        ObjectIds ids;
+
+        size_t depth = 0;
+        std::string topKey;
+        bool inIds = false;
+
+        bool id(uint64_t value) {
+            if (value > std::numeric_limits<uint32_t>::max())
+                throw std::runtime_error(fmt::format("Object ID {} in search response is out of range.", value));
+
+            ids.push_back(static_cast<uint32_t>(value));
+
+            return true;
+        }
+
+        bool number_unsigned(number_unsigned_t value) override {
+            if (inIds)
+                return id(value);
+
+            if (depth == 1 && topKey == "total")
+                ids.reserve(std::min<uint64_t>(value, 1 << 20));
+
+            return true;
+        }
+
+        bool number_integer(number_integer_t value) override {
+            if (inIds && value < 0)
+                throw std::runtime_error(fmt::format("Object ID {} in search response is out of range.", value));
+
+            return number_unsigned(static_cast<number_unsigned_t>(value));
+        }
+
+        bool number_float(number_float_t, const string_t &) override {
+            if (inIds)
+                throw std::runtime_error("Search response holds an object ID that isn't a whole number.");
+
+            return true;
+        }
+
+        bool null() override { return true; }
+        bool boolean(bool) override { return true; }
+        bool string(string_t &) override { return true; }
+        bool binary(binary_t &) override { return true; }
+
+        bool start_object(size_t) override {
+            depth++;
+            return true;
+        }
+
+        bool end_object() override {
+            depth--;
+            return true;
+        }
+
+        bool key(string_t &value) override {
+            if (depth == 1)
+                topKey = value;
+
+            return true;
+        }
+
+        bool start_array(size_t) override {
+            depth++;
+            inIds = depth == 2 && topKey == "objectIDs";
+
+            return true;
+        }
+
+        bool end_array() override {
+            depth--;
+            inIds = false;
+
+            return true;
+        }
+
+        bool parse_error(size_t position, const std::string &, const nlohmann::detail::exception &error) override {
+            throw std::runtime_error(fmt::format("Malformed search response at byte {}: {}", position, error.what()));
+        }
+    };
+
+    struct CacheHeader {
+        char magic[8];
+        uint32_t format;
+
+        // Lengths of the URL, ETag and Last-Modified strings that follow, then count IDs.
+        uint32_t urlSize;
+        uint32_t etagSize;
+        uint32_t modifiedSize;
+        uint64_t count;
+    };
+
+    struct CachedIds {
+        std::string etag;
+        std::string lastModified;
+        ObjectIds ids;
+    };
+}
+
+static constexpr char cacheMagic[8] = { 'P', 'A', 'I', 'N', 'T', 'I', 'D', 'S' };
+static constexpr uint32_t cacheFormat = 1;
+
+// FNV-1a, only has to spread URLs over file names.
+static uint64_t hashUrl(const std::string &url) {
+    uint64_t hash = 14695981039346656037ull;
+
+    for (char c : url) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+ObjectIds parseIds(const uint8_t *data, size_t size) {
+    IdHandler handler;
+    json::sax_parse(data, data + size, &handler);
+
+    return std::move(handler.ids);
+}
+
+ObjectIds readIds(const fs::path &path) {
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream)
+        throw std::runtime_error(fmt::format("Could not open ID file \"{}\".", path.string()));
+
+    std::string text(std::istreambuf_iterator<char>(stream), { });
+
+    ObjectIds ids;
+
+    size_t line = 0;
+
+    for (size_t start = 0; start < text.size();) {
+        size_t end = text.find('\n', start);
+        if (end == std::string::npos)
+            end = text.size();
+
+        line++;
+
+        const char *first = text.data() + start;
+        const char *last = text.data() + end;
+
+        while (first < last && std::isspace(static_cast<unsigned char>(*first)))
+            first++;
+        while (last > first && std::isspace(static_cast<unsigned char>(last[-1])))
+            last--;
+
+        if (first < last) {
+            uint32_t id;
+            auto [rest, error] = std::from_chars(first, last, id);
+
+            if (error != std::errc() || rest != last)
+                throw std::runtime_error(fmt::format("Line {} of \"{}\" is not an object ID.", line, path.string()));
+
+            ids.push_back(id);
+        }
+
+        start = end + 1;
+    }
+
+    return ids;
+}
+
+// Best effort like the image cache, a list that can't be read is just fetched again.
+static bool loadCached(const fs::path &path, const std::string &url, CachedIds &cached) {
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream)
+        return false;
+
+    CacheHeader header;
+    if (!stream.read(reinterpret_cast<char *>(&header), sizeof(header)))
+        return false;
+
+    if (std::memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0 || header.format != cacheFormat)
+        return false;
+
+    // A truncated or damaged file shouldn't get to size the buffers below.
+    std::error_code error;
+    uint64_t size = fs::file_size(path, error);
+
+    if (error || size != sizeof(header) + uint64_t(header.urlSize) + header.etagSize + header.modifiedSize
+        + header.count * sizeof(uint32_t))
+        return false;
+
+    std::string cachedUrl(header.urlSize, '\0');
+    cached.etag.resize(header.etagSize);
+    cached.lastModified.resize(header.modifiedSize);
+    cached.ids.resize(header.count);
+
+    stream.read(cachedUrl.data(), header.urlSize);
+    stream.read(cached.etag.data(), header.etagSize);
+    stream.read(cached.lastModified.data(), header.modifiedSize);
+    stream.read(reinterpret_cast<char *>(cached.ids.data()),
+        static_cast<std::streamsize>(header.count * sizeof(uint32_t)));
+
+    // Two searches could share a file name, the URL tells them apart.
+    return stream && cachedUrl == url;
+}
+
+static void storeCached(const fs::path &path, const std::string &url, const CachedIds &cached) {
+    static std::atomic<uint64_t> counter { 0 };
+
+    fs::path temporary = path;
+    temporary += fmt::format(".{}.{}.tmp", getpid(), counter++);
+
+    CacheHeader header { };
+    std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+    header.format = cacheFormat;
+    header.urlSize = static_cast<uint32_t>(url.size());
+    header.etagSize = static_cast<uint32_t>(cached.etag.size());
+    header.modifiedSize = static_cast<uint32_t>(cached.lastModified.size());
+    header.count = cached.ids.size();
+
+    std::error_code error;
+
+    {
+        std::ofstream stream(temporary, std::ios::binary);
+        stream.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        stream.write(url.data(), header.urlSize);
+        stream.write(cached.etag.data(), header.etagSize);
+        stream.write(cached.lastModified.data(), header.modifiedSize);
+        stream.write(reinterpret_cast<const char *>(cached.ids.data()),
+            static_cast<std::streamsize>(cached.ids.size() * sizeof(uint32_t)));
+
+        if (!stream) {
+            fs::remove(temporary, error);
+            return;
+        }
+    }
+
+    fs::rename(temporary, path, error);
+    if (error)
+        fs::remove(temporary, error);
+}
+
+ObjectIds searchIds(Downloader &downloader, const std::string &url, const fs::path &cacheDir) {
+    fs::path path;
+    CachedIds cached;
+    bool hit = false;
+
+    if (!cacheDir.empty()) {
+        std::error_code error;
+        fs::create_directories(cacheDir, error);
+
+        path = cacheDir / fmt::format("ids-{:016x}", hashUrl(url));
+        hit = loadCached(path, url, cached);
+    }
+
+    std::vector<std::string> headers;
+
+    if (hit && !cached.etag.empty())
+        headers.push_back("If-None-Match: " + cached.etag);
+    if (hit && !cached.lastModified.empty())
+        headers.push_back("If-Modified-Since: " + cached.lastModified);
+
+    Downloader::Response response = downloader.get(url, std::move(headers)).get();
+
+    if (hit && (response.status == 304 || response.error != CURLE_OK)) {
+        if (response.status != 304)
+            fmt::print("Failed to query IDs at {} ({}), using the cached list.\n", url, curl_easy_strerror(response.error));
+
+        // Modification time doubles as the last use for the image cache's eviction.
+        std::error_code error;
+        fs::last_write_time(path, fs::file_time_type::clock::now(), error);
+
+        return std::move(cached.ids);
+    }
+
+    if (response.error != CURLE_OK)
+        throw std::runtime_error(fmt::format("Failed to query IDs at {}: {}", url, curl_easy_strerror(response.error)));
+
+    cached.etag = response.header("ETag");
+    cached.lastModified = response.header("Last-Modified");
+    cached.ids = parseIds(response.body.data(), response.body.size());
+
+    if (!path.empty())
+        storeCached(path, url, cached);
+
+    return std::move(cached.ids);
+}
@@ -1,22 +1,82 @@
 #include <paintings/image.h>
 
+#include <paintings/buffers.h>
+#include <paintings/decoder.h>
+#include <paintings/files.h>
+
+// Whole decoded images are the allocations worth pooling, stb_image's own scratch buffers fall through to malloc.
+#define STBI_MALLOC(size) BufferPool::global().acquire(size)
+#define STBI_REALLOC(data, size) BufferPool::global().resize(static_cast<uint8_t *>(data), size)
+#define STBI_FREE(data) BufferPool::global().release(static_cast<uint8_t *>(data))
+
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#include <new>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+// Files go through the same decoders as downloads, so every tool gets the same pixels out of the same image.
 ImageData::ImageData(const std::string &path) {
-    data = stbi_load(path.c_str(), &width, &height, nullptr, 3);
+    std::vector<uint8_t> bytes = readFile(path);
 
-    if (!data)
-        throw std::runtime_error("Something went horribly wrong...");
+    *this = ImageData(bytes.data(), bytes.size());
 }
 
-ImageData::ImageData(const uint8_t *input, size_t size) {
-    data = stbi_load_from_memory(input, size, &width, &height, nullptr, 3);
+bool validDecodeScale(int32_t scale) {
+    return scale == 1 || scale == 2 || scale == 4 || scale == 8;
+}
+
+ImageData::ImageData(const uint8_t *input, size_t size, int32_t scale) {
+    // stb_image (always the last decoder) fills a buffer of its own, the faster backends get read out row by row.
+    const auto &backends = decoders();
+    bool fast = std::any_of(backends.begin(), backends.end() - 1, [input, size](const Decoder *decoder) {
+        return decoder->accepts(input, size);
+    });
+
+    if (scale == 1 && !fast) {
+        data = stbi_load_from_memory(input, size, &width, &height, nullptr, 3);
+
+        if (!data)
+            throw std::runtime_error("Something went horribly wrong...");
+
+        return;
+    }
 
+    auto reader = ImageReader::open(input, size, scale);
+
+    width = reader->width;
+    height = reader->height;
+
+    data = BufferPool::global().acquire(static_cast<size_t>(width) * height * 3);
     if (!data)
-        throw std::runtime_error("Something went horribly wrong...");
+        throw std::bad_alloc();
+
+    try {
+        reader->read(data, height);
+    } catch (...) {
+        BufferPool::global().release(data);
+        throw;
+    }
+}
+
+ImageData::ImageData(ImageData &&other) noexcept
+    : width(other.width), height(other.height), data(std::exchange(other.data, nullptr)) { }
+
+ImageData &ImageData::operator=(ImageData &&other) noexcept {
+    if (this != &other) {
+        BufferPool::global().release(data);
+
+        width = other.width;
+        height = other.height;
+        data = std::exchange(other.data, nullptr);
+    }
+
+    return *this;
 }
 
 ImageData::~ImageData() {
-    stbi_image_free(data);
+    BufferPool::global().release(data);
 }
@@ -0,0 +1,197 @@
+#include <paintings/journal.h>
+
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+
+namespace {
+    struct Header {
+        char magic[8];
+        uint32_t format;
+        uint32_t version;
+        uint64_t seed;
+        uint64_t settings;
+    };
+}
+
+struct Journal::Record {
+    uint64_t objectId;
+
+    // Covers the whole record with this zeroed, a record torn by a crash doesn't match.
+    uint32_t checksum;
+    uint32_t failed;
+
+    uint64_t numPixels;
+    uint64_t sampleFrequency[samples.size()];
+    double lower[samples.size()];
+    double upper[samples.size()];
+};
+
+static_assert(sizeof(Header) == 32);
+static_assert(sizeof(Journal::Record) % 8 == 0);
+
+static constexpr char journalMagic[8] = { 'P', 'A', 'I', 'N', 'T', 'J', 'N', 'L' };
+static constexpr uint32_t journalFormat = 2;
+
+// FNV-1a.
+static uint64_t hashBytes(const void *data, size_t size) {
+    uint64_t hash = 14695981039346656037ull;
+
+    for (size_t a = 0; a < size; a++) {
+        hash ^= static_cast<const uint8_t *>(data)[a];
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+static uint32_t checksum(Journal::Record record) {
+    record.checksum = 0;
+    uint64_t hash = hashBytes(&record, sizeof(record));
+
+    return static_cast<uint32_t>(hash ^ hash >> 32);
+}
+
+Journal::Journal(const std::string &path, bool resume, uint64_t seed, const std::string &settings)
+    : seed(seed), path(path), synced(std::chrono::steady_clock::now()) {
+    file = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (file < 0)
+        throw std::runtime_error("Could not open journal at \"" + path + "\".");
+
+    if (flock(file, LOCK_EX | LOCK_NB) != 0) {
+        close(file);
+        throw std::runtime_error("Journal at \"" + path + "\" is in use by another process.");
+    }
+
+    off_t size = lseek(file, 0, SEEK_END);
+
+    if (size > 0 && !resume) {
+        close(file);
+        throw std::runtime_error("\"" + path + "\" already holds a journal, add --resume to go on with it.");
+    }
+
+    if (size == 0 && resume) {
+        close(file);
+        throw std::runtime_error("There's no journal at \"" + path + "\" to resume.");
+    }
+
+    uint64_t settingsHash = hashBytes(settings.data(), settings.size());
+
+    if (size == 0) {
+        Header header = { };
+        std::memcpy(header.magic, journalMagic, sizeof(journalMagic));
+        header.format = journalFormat;
+        header.version = classifierVersion;
+        header.seed = seed;
+        header.settings = settingsHash;
+
+        if (::write(file, &header, sizeof(header)) != sizeof(header) || fdatasync(file) != 0) {
+            close(file);
+            throw std::runtime_error("Could not write journal at \"" + path + "\".");
+        }
+
+        return;
+    }
+
+    Header header = { };
+
+    if (pread(file, &header, sizeof(header), 0) != sizeof(header)
+        || std::memcmp(header.magic, journalMagic, sizeof(journalMagic)) != 0
+        || header.format != journalFormat) {
+        close(file);
+        throw std::runtime_error("\"" + path + "\" is not a journal.");
+    }
+
+    if (header.version != classifierVersion || header.settings != settingsHash) {
+        close(file);
+        throw std::runtime_error("Journal at \"" + path + "\" is from a run with other settings or object IDs.");
+    }
+
+    this->seed = header.seed;
+
+    // Everything up to the first record that's cut short or torn, the rest is cut off and appended over.
+    off_t end = sizeof(Header);
+
+    for (Record record; pread(file, &record, sizeof(record), end) == sizeof(record); end += sizeof(record)) {
+        if (record.checksum != checksum(record))
+            break;
+
+        Entry &entry = recovered.emplace_back();
+        entry.objectId = record.objectId;
+        entry.failed = record.failed != 0;
+
+        if (!entry.failed) {
+            std::array<uint64_t, samples.size()> frequency;
+            std::memcpy(frequency.data(), record.sampleFrequency, sizeof(record.sampleFrequency));
+
+            entry.result = AnalysisResult(record.numPixels, frequency);
+            std::memcpy(entry.result.lower.data(), record.lower, sizeof(record.lower));
+            std::memcpy(entry.result.upper.data(), record.upper, sizeof(record.upper));
+        }
+    }
+
+    if ((end != size && ftruncate(file, end) != 0) || lseek(file, end, SEEK_SET) != end) {
+        close(file);
+        throw std::runtime_error("Could not repair journal at \"" + path + "\".");
+    }
+}
+
+Journal::~Journal() {
+    fdatasync(file);
+    close(file);
+}
+
+void Journal::append(uint64_t objectId, const AnalysisResult &result) {
+    Record record = { };
+    record.objectId = objectId;
+    record.numPixels = result.numPixels;
+    std::memcpy(record.sampleFrequency, result.sampleFrequency.data(), sizeof(record.sampleFrequency));
+    std::memcpy(record.lower, result.lower.data(), sizeof(record.lower));
+    std::memcpy(record.upper, result.upper.data(), sizeof(record.upper));
+
+    write(record);
+}
+
+void Journal::fail(uint64_t objectId) {
+    Record record = { };
+    record.objectId = objectId;
+    record.failed = 1;
+
+    write(record);
+}
+
+// Records go to the file one by one, only the sync waits for the disk. It runs outside the lock so the other
+// threads can keep appending meanwhile, and one at a time.
+void Journal::write(Record &record) {
+    record.checksum = checksum(record);
+
+    bool sync;
+
+    {
+        std::lock_guard lock(mutex);
+
+        if (::write(file, &record, sizeof(record)) != sizeof(record))
+            throw std::runtime_error("Could not write to journal at \"" + path + "\".");
+
+        unsynced++;
+
+        auto now = std::chrono::steady_clock::now();
+        sync = !syncing && (unsynced >= syncRecords || now - synced >= syncInterval);
+
+        if (sync) {
+            syncing = true;
+            unsynced = 0;
+            synced = now;
+        }
+    }
+
+    if (sync) {
+        fdatasync(file);
+
+        std::lock_guard lock(mutex);
+        syncing = false;
+    }
+}
@@ -0,0 +1,589 @@
+#include <paintings/kernel.h>
+
+
+#include <algorithm>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define PAINTINGS_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+// The vector kernels classify on s = max + min and d = max - min with the integer thresholds from
+// HueClassifier, and pick the hue sextant by comparing 2t against +-d, where t is the difference
+// of the two channels that aren't the max. Pixels sitting exactly on a threshold or sextant boundary
+// round either way in double precision, so they get class Classifier::size and come from the ColorTable.
+template <typename Classifier>
+static void classifyTable(const uint8_t *pixels, size_t count, uint64_t *frequency) {
+    const RGB *colors = reinterpret_cast<const RGB *>(pixels);
+    const ColorTable<Classifier> &table = ColorTable<Classifier>::get();
+
+    for (size_t a = 0; a < count; a++)
+        frequency[table.classify(colors[a])]++;
+}
+
+template <typename Classifier>
+static void classifyTies(const uint8_t *pixels, uint64_t ties, uint64_t *frequency) {
+    const RGB *colors = reinterpret_cast<const RGB *>(pixels);
+    const ColorTable<Classifier> &table = ColorTable<Classifier>::get();
+
+    while (ties) {
+        frequency[table.classify(colors[__builtin_ctzll(ties)])]++;
+        ties &= ties - 1;
+    }
+}
+
+template <typename Classifier>
+static void nearestTable(const uint8_t *pixels, size_t count, const NearestCounts &counts) {
+    const RGB *colors = reinterpret_cast<const RGB *>(pixels);
+
+    for (size_t a = 0; a < count; a++) {
+        auto diff = Classifier::template nearest<false>(colors[a]);
+        auto square = Classifier::template nearest<true>(colors[a]);
+
+        counts.sampleFrequency[diff.index]++;
+        counts.squaredFrequency[square.index]++;
+        counts.sampleScore[diff.index] += diff.distance;
+        counts.squaredScore[square.index] += square.distance;
+    }
+}
+
+#ifdef PAINTINGS_X86_KERNELS
+
+// pshufb masks pulling channel [a] of 16 pixels out of load [b] of three consecutive 16 byte loads.
+constexpr int8_t X = -1;
+alignas(16) static const int8_t shuffles[3][3][16] = {
+    {
+        { 0, 3, 6, 9, 12, 15, X, X, X, X, X, X, X, X, X, X },
+        { X, X, X, X, X, X, 2, 5, 8, 11, 14, X, X, X, X, X },
+        { X, X, X, X, X, X, X, X, X, X, X, 1, 4, 7, 10, 13 },
+    },
+    {
+        { 1, 4, 7, 10, 13, X, X, X, X, X, X, X, X, X, X, X },
+        { X, X, X, X, X, 0, 3, 6, 9, 12, 15, X, X, X, X, X },
+        { X, X, X, X, X, X, X, X, X, X, X, 2, 5, 8, 11, 14 },
+    },
+    {
+        { 2, 5, 8, 11, 14, X, X, X, X, X, X, X, X, X, X, X },
+        { X, X, X, X, X, 1, 4, 7, 10, 13, X, X, X, X, X, X },
+        { X, X, X, X, X, X, X, X, X, X, 0, 3, 6, 9, 12, 15 },
+    },
+};
+
+template <typename Classifier>
+__attribute__((target("sse4.1")))
+static __m128i classifySSE41(__m128i r, __m128i g, __m128i b) {
+    const __m128i zero = _mm_setzero_si128();
+
+    __m128i max = _mm_max_epi16(r, _mm_max_epi16(g, b));
+    __m128i min = _mm_min_epi16(r, _mm_min_epi16(g, b));
+    __m128i sum = _mm_add_epi16(max, min);
+    __m128i diff = _mm_sub_epi16(max, min);
+    __m128i den = _mm_min_epi16(sum, _mm_sub_epi16(_mm_set1_epi16(510), sum));
+
+    __m128i satLeft = _mm_mullo_epi16(diff, _mm_set1_epi16(Classifier::grayDiff));
+    __m128i satRight = _mm_mullo_epi16(den, _mm_set1_epi16(Classifier::grayDen));
+    __m128i gray = _mm_cmplt_epi16(satLeft, satRight);
+
+    __m128i redMax = _mm_cmpeq_epi16(r, max);
+    __m128i greenMax = _mm_andnot_si128(redMax, _mm_cmpeq_epi16(g, max));
+
+    __m128i t = _mm_sub_epi16(r, g);
+    __m128i base = _mm_set1_epi16(4);
+    t = _mm_blendv_epi8(t, _mm_sub_epi16(b, r), greenMax);
+    base = _mm_blendv_epi8(base, _mm_set1_epi16(2), greenMax);
+    t = _mm_blendv_epi8(t, _mm_sub_epi16(g, b), redMax);
+    base = _mm_blendv_epi8(base, zero, redMax);
+    t = _mm_add_epi16(t, t);
+
+    // base + 1, minus one if 2t < d, minus another if 2t < -d, wrapped into [0, 6)
+    __m128i negDiff = _mm_sub_epi16(zero, diff);
+    __m128i result = _mm_add_epi16(base, _mm_set1_epi16(1));
+    result = _mm_add_epi16(result, _mm_cmplt_epi16(t, diff));
+    result = _mm_add_epi16(result, _mm_cmplt_epi16(t, negDiff));
+    result = _mm_add_epi16(result, _mm_and_si128(_mm_cmplt_epi16(result, zero), _mm_set1_epi16(6)));
+
+    __m128i tie = _mm_or_si128(_mm_cmpeq_epi16(t, diff), _mm_cmpeq_epi16(t, negDiff));
+    tie = _mm_or_si128(_mm_andnot_si128(gray, tie), _mm_cmpeq_epi16(satLeft, satRight));
+
+    if constexpr (Classifier::blackTie)
+        tie = _mm_or_si128(tie, _mm_cmpeq_epi16(sum, _mm_set1_epi16(Classifier::blackSum)));
+    if constexpr (Classifier::whiteTie)
+        tie = _mm_or_si128(tie, _mm_cmpeq_epi16(sum, _mm_set1_epi16(Classifier::whiteSum)));
+
+    result = _mm_blendv_epi8(result, _mm_set1_epi16(8), gray);
+    result = _mm_blendv_epi8(result, _mm_set1_epi16(Classifier::size), tie);
+    result = _mm_blendv_epi8(result, _mm_set1_epi16(7), _mm_cmpgt_epi16(sum, _mm_set1_epi16(Classifier::whiteSum)));
+    result = _mm_blendv_epi8(result, _mm_set1_epi16(6), _mm_cmplt_epi16(sum, _mm_set1_epi16(Classifier::blackSum)));
+
+    return result;
+}
+
+template <typename Classifier>
+__attribute__((target("sse4.1")))
+static void classifySSE41(const uint8_t *pixels, size_t count, uint64_t *frequency) {
+    __m128i masks[3][3];
+    for (size_t a = 0; a < 3; a++) {
+        for (size_t b = 0; b < 3; b++)
+            masks[a][b] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(shuffles[a][b]));
+    }
+
+    const __m128i zero = _mm_setzero_si128();
+
+    __m128i totals[Classifier::size];
+    for (__m128i &total : totals)
+        total = zero;
+
+    size_t blocks = count / 16;
+
+    for (size_t a = 0; a < blocks;) {
+        // 8 bit counters, flushed before they can overflow.
+        __m128i counters[Classifier::size];
+        for (__m128i &counter : counters)
+            counter = zero;
+
+        for (size_t end = std::min(blocks, a + 255); a < end; a++) {
+            const uint8_t *block = pixels + a * 48;
+
+            __m128i loads[3];
+            for (size_t b = 0; b < 3; b++)
+                loads[b] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + b * 16));
+
+            __m128i channels[3];
+            for (size_t b = 0; b < 3; b++) {
+                channels[b] = _mm_or_si128(
+                    _mm_or_si128(_mm_shuffle_epi8(loads[0], masks[b][0]), _mm_shuffle_epi8(loads[1], masks[b][1])),
+                    _mm_shuffle_epi8(loads[2], masks[b][2]));
+            }
+
+            __m128i low = classifySSE41<Classifier>(
+                _mm_unpacklo_epi8(channels[0], zero),
+                _mm_unpacklo_epi8(channels[1], zero),
+                _mm_unpacklo_epi8(channels[2], zero));
+            __m128i high = classifySSE41<Classifier>(
+                _mm_unpackhi_epi8(channels[0], zero),
+                _mm_unpackhi_epi8(channels[1], zero),
+                _mm_unpackhi_epi8(channels[2], zero));
+            __m128i classes = _mm_packus_epi16(low, high);
+
+            for (size_t c = 0; c < Classifier::size; c++)
+                counters[c] = _mm_sub_epi8(counters[c], _mm_cmpeq_epi8(classes, _mm_set1_epi8(c)));
+
+            auto ties = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(classes, _mm_set1_epi8(Classifier::size))));
+            if (ties)
+                classifyTies<Classifier>(block, ties, frequency);
+        }
+
+        for (size_t c = 0; c < Classifier::size; c++)
+            totals[c] = _mm_add_epi64(totals[c], _mm_sad_epu8(counters[c], zero));
+    }
+
+    for (size_t c = 0; c < Classifier::size; c++)
+        frequency[c] += _mm_extract_epi64(totals[c], 0) + _mm_extract_epi64(totals[c], 1);
+
+    classifyTable<Classifier>(pixels + blocks * 48, count - blocks * 16, frequency);
+}
+
+template <typename Classifier>
+__attribute__((target("avx2")))
+static __m256i classifyAVX2(__m256i r, __m256i g, __m256i b) {
+    const __m256i zero = _mm256_setzero_si256();
+
+    __m256i max = _mm256_max_epi16(r, _mm256_max_epi16(g, b));
+    __m256i min = _mm256_min_epi16(r, _mm256_min_epi16(g, b));
+    __m256i sum = _mm256_add_epi16(max, min);
+    __m256i diff = _mm256_sub_epi16(max, min);
+    __m256i den = _mm256_min_epi16(sum, _mm256_sub_epi16(_mm256_set1_epi16(510), sum));
+
+    __m256i satLeft = _mm256_mullo_epi16(diff, _mm256_set1_epi16(Classifier::grayDiff));
+    __m256i satRight = _mm256_mullo_epi16(den, _mm256_set1_epi16(Classifier::grayDen));
+    __m256i gray = _mm256_cmpgt_epi16(satRight, satLeft);
+
+    __m256i redMax = _mm256_cmpeq_epi16(r, max);
+    __m256i greenMax = _mm256_andnot_si256(redMax, _mm256_cmpeq_epi16(g, max));
+
+    __m256i t = _mm256_sub_epi16(r, g);
+    __m256i base = _mm256_set1_epi16(4);
+    t = _mm256_blendv_epi8(t, _mm256_sub_epi16(b, r), greenMax);
+    base = _mm256_blendv_epi8(base, _mm256_set1_epi16(2), greenMax);
+    t = _mm256_blendv_epi8(t, _mm256_sub_epi16(g, b), redMax);
+    base = _mm256_blendv_epi8(base, zero, redMax);
+    t = _mm256_add_epi16(t, t);
+
+    __m256i negDiff = _mm256_sub_epi16(zero, diff);
+    __m256i result = _mm256_add_epi16(base, _mm256_set1_epi16(1));
+    result = _mm256_add_epi16(result, _mm256_cmpgt_epi16(diff, t));
+    result = _mm256_add_epi16(result, _mm256_cmpgt_epi16(negDiff, t));
+    result = _mm256_add_epi16(result, _mm256_and_si256(_mm256_cmpgt_epi16(zero, result), _mm256_set1_epi16(6)));
+
+    __m256i tie = _mm256_or_si256(_mm256_cmpeq_epi16(t, diff), _mm256_cmpeq_epi16(t, negDiff));
+    tie = _mm256_or_si256(_mm256_andnot_si256(gray, tie), _mm256_cmpeq_epi16(satLeft, satRight));
+
+    if constexpr (Classifier::blackTie)
+        tie = _mm256_or_si256(tie, _mm256_cmpeq_epi16(sum, _mm256_set1_epi16(Classifier::blackSum)));
+    if constexpr (Classifier::whiteTie)
+        tie = _mm256_or_si256(tie, _mm256_cmpeq_epi16(sum, _mm256_set1_epi16(Classifier::whiteSum)));
+
+    result = _mm256_blendv_epi8(result, _mm256_set1_epi16(8), gray);
+    result = _mm256_blendv_epi8(result, _mm256_set1_epi16(Classifier::size), tie);
+    result = _mm256_blendv_epi8(result, _mm256_set1_epi16(7), _mm256_cmpgt_epi16(sum, _mm256_set1_epi16(Classifier::whiteSum)));
+    result = _mm256_blendv_epi8(result, _mm256_set1_epi16(6), _mm256_cmpgt_epi16(_mm256_set1_epi16(Classifier::blackSum), sum));
+
+    return result;
+}
+
+template <typename Classifier>
+__attribute__((target("avx2")))
+static void classifyAVX2(const uint8_t *pixels, size_t count, uint64_t *frequency) {
+    __m256i masks[3][3];
+    for (size_t a = 0; a < 3; a++) {
+        for (size_t b = 0; b < 3; b++)
+            masks[a][b] = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(shuffles[a][b])));
+    }
+
+    const __m256i zero = _mm256_setzero_si256();
+
+    __m256i totals[Classifier::size];
+    for (__m256i &total : totals)
+        total = zero;
+
+    // Each 128 bit lane deinterleaves its own 16 pixels, so a block is two 48 byte runs.
+    size_t blocks = count / 32;
+
+    for (size_t a = 0; a < blocks;) {
+        __m256i counters[Classifier::size];
+        for (__m256i &counter : counters)
+            counter = zero;
+
+        for (size_t end = std::min(blocks, a + 255); a < end; a++) {
+            const uint8_t *block = pixels + a * 96;
+
+            __m256i loads[3];
+            for (size_t b = 0; b < 3; b++) {
+                loads[b] = _mm256_inserti128_si256(
+                    _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(block + b * 16))),
+                    _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + 48 + b * 16)), 1);
+            }
+
+            __m256i channels[3];
+            for (size_t b = 0; b < 3; b++) {
+                channels[b] = _mm256_or_si256(
+                    _mm256_or_si256(
+                        _mm256_shuffle_epi8(loads[0], masks[b][0]),
+                        _mm256_shuffle_epi8(loads[1], masks[b][1])),
+                    _mm256_shuffle_epi8(loads[2], masks[b][2]));
+            }
+
+            __m256i low = classifyAVX2<Classifier>(
+                _mm256_unpacklo_epi8(channels[0], zero),
+                _mm256_unpacklo_epi8(channels[1], zero),
+                _mm256_unpacklo_epi8(channels[2], zero));
+            __m256i high = classifyAVX2<Classifier>(
+                _mm256_unpackhi_epi8(channels[0], zero),
+                _mm256_unpackhi_epi8(channels[1], zero),
+                _mm256_unpackhi_epi8(channels[2], zero));
+            __m256i classes = _mm256_packus_epi16(low, high);
+
+            for (size_t c = 0; c < Classifier::size; c++)
+                counters[c] = _mm256_sub_epi8(counters[c], _mm256_cmpeq_epi8(classes, _mm256_set1_epi8(c)));
+
+            auto ties = static_cast<uint32_t>(
+                _mm256_movemask_epi8(_mm256_cmpeq_epi8(classes, _mm256_set1_epi8(Classifier::size))));
+            if (ties)
+                classifyTies<Classifier>(block, ties, frequency);
+        }
+
+        for (size_t c = 0; c < Classifier::size; c++)
+            totals[c] = _mm256_add_epi64(totals[c], _mm256_sad_epu8(counters[c], zero));
+    }
+
+    for (size_t c = 0; c < Classifier::size; c++) {
+        __m128i total = _mm_add_epi64(_mm256_castsi256_si128(totals[c]), _mm256_extracti128_si256(totals[c], 1));
+        frequency[c] += _mm_extract_epi64(total, 0) + _mm_extract_epi64(total, 1);
+    }
+
+    classifyTable<Classifier>(pixels + blocks * 96, count - blocks * 32, frequency);
+}
+
+template <typename Classifier>
+__attribute__((target("avx512f,avx512bw")))
+static __m512i classifyAVX512(__m512i r, __m512i g, __m512i b) {
+    const __m512i zero = _mm512_setzero_si512();
+
+    __m512i max = _mm512_max_epi16(r, _mm512_max_epi16(g, b));
+    __m512i min = _mm512_min_epi16(r, _mm512_min_epi16(g, b));
+    __m512i sum = _mm512_add_epi16(max, min);
+    __m512i diff = _mm512_sub_epi16(max, min);
+    __m512i den = _mm512_min_epi16(sum, _mm512_sub_epi16(_mm512_set1_epi16(510), sum));
+
+    __m512i satLeft = _mm512_mullo_epi16(diff, _mm512_set1_epi16(Classifier::grayDiff));
+    __m512i satRight = _mm512_mullo_epi16(den, _mm512_set1_epi16(Classifier::grayDen));
+    __mmask32 gray = _mm512_cmplt_epi16_mask(satLeft, satRight);
+
+    __mmask32 redMax = _mm512_cmpeq_epi16_mask(r, max);
+    __mmask32 greenMax = _mm512_cmpeq_epi16_mask(g, max) & ~redMax;
+
+    __m512i t = _mm512_sub_epi16(r, g);
+    __m512i base = _mm512_set1_epi16(4);
+    t = _mm512_mask_blend_epi16(greenMax, t, _mm512_sub_epi16(b, r));
+    base = _mm512_mask_blend_epi16(greenMax, base, _mm512_set1_epi16(2));
+    t = _mm512_mask_blend_epi16(redMax, t, _mm512_sub_epi16(g, b));
+    base = _mm512_mask_blend_epi16(redMax, base, zero);
+    t = _mm512_add_epi16(t, t);
+
+    __m512i negDiff = _mm512_sub_epi16(zero, diff);
+    __m512i one = _mm512_set1_epi16(1);
+    __m512i result = _mm512_add_epi16(base, one);
+    result = _mm512_mask_sub_epi16(result, _mm512_cmplt_epi16_mask(t, diff), result, one);
+    result = _mm512_mask_sub_epi16(result, _mm512_cmplt_epi16_mask(t, negDiff), result, one);
+    result = _mm512_mask_add_epi16(result, _mm512_cmplt_epi16_mask(result, zero), result, _mm512_set1_epi16(6));
+
+    __mmask32 tie = _mm512_cmpeq_epi16_mask(t, diff) | _mm512_cmpeq_epi16_mask(t, negDiff);
+    tie = (tie & ~gray) | _mm512_cmpeq_epi16_mask(satLeft, satRight);
+
+    if constexpr (Classifier::blackTie)
+        tie |= _mm512_cmpeq_epi16_mask(sum, _mm512_set1_epi16(Classifier::blackSum));
+    if constexpr (Classifier::whiteTie)
+        tie |= _mm512_cmpeq_epi16_mask(sum, _mm512_set1_epi16(Classifier::whiteSum));
+
+    result = _mm512_mask_blend_epi16(gray, result, _mm512_set1_epi16(8));
+    result = _mm512_mask_blend_epi16(tie, result, _mm512_set1_epi16(Classifier::size));
+    result = _mm512_mask_blend_epi16(
+        _mm512_cmpgt_epi16_mask(sum, _mm512_set1_epi16(Classifier::whiteSum)), result, _mm512_set1_epi16(7));
+    result = _mm512_mask_blend_epi16(
+        _mm512_cmplt_epi16_mask(sum, _mm512_set1_epi16(Classifier::blackSum)), result, _mm512_set1_epi16(6));
+
+    return result;
+}
+
+template <typename Classifier>
+__attribute__((target("avx512f,avx512bw")))
+static void classifyAVX512(const uint8_t *pixels, size_t count, uint64_t *frequency) {
+    // Zero masked, the plain broadcast passes an undefined vector through that GCC 12 warns about at -O2 -Wall.
+    __m512i masks[3][3];
+    for (size_t a = 0; a < 3; a++) {
+        for (size_t b = 0; b < 3; b++)
+            masks[a][b] = _mm512_maskz_broadcast_i32x4(0xFFFF,
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(shuffles[a][b])));
+    }
+
+    const __m512i zero = _mm512_setzero_si512();
+
+    __m512i totals[Classifier::size];
+    for (__m512i &total : totals)
+        total = zero;
+
+    // Four 48 byte runs per block, one per 128 bit lane.
+    size_t blocks = count / 64;
+
+    for (size_t a = 0; a < blocks;) {
+        __m512i counters[Classifier::size];
+        for (__m512i &counter : counters)
+            counter = zero;
+
+        for (size_t end = std::min(blocks, a + 255); a < end; a++) {
+            const uint8_t *block = pixels + a * 192;
+
+            __m512i loads[3];
+            for (size_t b = 0; b < 3; b++) {
+                auto load = [block, b](size_t lane) {
+                    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + lane * 48 + b * 16));
+                };
+
+                loads[b] = _mm512_castsi128_si512(load(0));
+                loads[b] = _mm512_inserti32x4(loads[b], load(1), 1);
+                loads[b] = _mm512_inserti32x4(loads[b], load(2), 2);
+                loads[b] = _mm512_inserti32x4(loads[b], load(3), 3);
+            }
+
+            __m512i channels[3];
+            for (size_t b = 0; b < 3; b++) {
+                channels[b] = _mm512_or_si512(
+                    _mm512_or_si512(
+                        _mm512_shuffle_epi8(loads[0], masks[b][0]),
+                        _mm512_shuffle_epi8(loads[1], masks[b][1])),
+                    _mm512_shuffle_epi8(loads[2], masks[b][2]));
+            }
+
+            __m512i low = classifyAVX512<Classifier>(
+                _mm512_unpacklo_epi8(channels[0], zero),
+                _mm512_unpacklo_epi8(channels[1], zero),
+                _mm512_unpacklo_epi8(channels[2], zero));
+            __m512i high = classifyAVX512<Classifier>(
+                _mm512_unpackhi_epi8(channels[0], zero),
+                _mm512_unpackhi_epi8(channels[1], zero),
+                _mm512_unpackhi_epi8(channels[2], zero));
+            __m512i classes = _mm512_packus_epi16(low, high);
+
+            for (size_t c = 0; c < Classifier::size; c++) {
+                __mmask64 match = _mm512_cmpeq_epi8_mask(classes, _mm512_set1_epi8(c));
+                counters[c] = _mm512_sub_epi8(counters[c], _mm512_movm_epi8(match));
+            }
+
+            __mmask64 ties = _mm512_cmpeq_epi8_mask(classes, _mm512_set1_epi8(Classifier::size));
+            if (ties)
+                classifyTies<Classifier>(block, ties, frequency);
+        }
+
+        for (size_t c = 0; c < Classifier::size; c++)
+            totals[c] = _mm512_add_epi64(totals[c], _mm512_sad_epu8(counters[c], zero));
+    }
+
+    // Summed from memory for the same reason, _mm512_reduce_add_epi64 extracts into undefined vectors too.
+    for (size_t c = 0; c < Classifier::size; c++) {
+        alignas(64) uint64_t lanes[8];
+        _mm512_store_si512(lanes, totals[c]);
+
+        for (uint64_t lane : lanes)
+            frequency[c] += lane;
+    }
+
+    classifyTable<Classifier>(pixels + blocks * 192, count - blocks * 64, frequency);
+}
+
+// 8 pixels per step, one per 32 bit lane, laid out as 16 bit (red, green) and (blue, 0) pairs
+// so pmaddwd gives the squared distances straight away.
+alignas(16) static const int8_t nearestShuffles[2][16] = {
+    { 0, X, 1, X, 3, X, 4, X, 6, X, 7, X, 9, X, 10, X },
+    { 2, X, X, X, 5, X, X, X, 8, X, X, X, 11, X, X, X },
+};
+
+template <typename Classifier>
+__attribute__((target("avx2")))
+static void nearestAVX2(const uint8_t *pixels, size_t count, const NearestCounts &counts) {
+    const __m256i redGreenMask = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(nearestShuffles[0])));
+    const __m256i blueMask = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(nearestShuffles[1])));
+    const __m256i ones = _mm256_set1_epi16(1);
+
+    // The second 16 byte load of a step reads 4 bytes past its 8 pixels.
+    size_t blocks = count >= 10 ? (count - 2) / 8 : 0;
+
+    alignas(32) int32_t indices[2][8];
+    alignas(32) int32_t distances[2][8];
+
+    for (size_t a = 0; a < blocks; a++) {
+        const uint8_t *block = pixels + a * 24;
+
+        __m256i load = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(block))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + 12)), 1);
+
+        __m256i redGreen = _mm256_shuffle_epi8(load, redGreenMask);
+        __m256i blue = _mm256_shuffle_epi8(load, blueMask);
+
+        __m256i bestDiff = _mm256_set1_epi32(INT32_MAX);
+        __m256i bestSquare = _mm256_set1_epi32(INT32_MAX);
+        __m256i diffIndex = _mm256_setzero_si256();
+        __m256i squareIndex = _mm256_setzero_si256();
+
+        for (size_t b = 0; b < Classifier::size; b++) {
+            const RGB &color = Classifier::colors[b];
+
+            __m256i deltaRedGreen = _mm256_abs_epi16(
+                _mm256_sub_epi16(redGreen, _mm256_set1_epi32(color.red | (color.green << 16))));
+            __m256i deltaBlue = _mm256_abs_epi16(_mm256_sub_epi16(blue, _mm256_set1_epi32(color.blue)));
+
+            __m256i diff = _mm256_add_epi32(_mm256_madd_epi16(deltaRedGreen, ones), deltaBlue);
+            __m256i square = _mm256_add_epi32(
+                _mm256_madd_epi16(deltaRedGreen, deltaRedGreen), _mm256_madd_epi16(deltaBlue, deltaBlue));
+
+            // Strictly closer only, so ties keep the earlier palette entry.
+            __m256i index = _mm256_set1_epi32(b);
+            __m256i closerDiff = _mm256_cmpgt_epi32(bestDiff, diff);
+            __m256i closerSquare = _mm256_cmpgt_epi32(bestSquare, square);
+
+            bestDiff = _mm256_min_epi32(bestDiff, diff);
+            bestSquare = _mm256_min_epi32(bestSquare, square);
+            diffIndex = _mm256_blendv_epi8(diffIndex, index, closerDiff);
+            squareIndex = _mm256_blendv_epi8(squareIndex, index, closerSquare);
+        }
+
+        _mm256_store_si256(reinterpret_cast<__m256i *>(indices[0]), diffIndex);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(indices[1]), squareIndex);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(distances[0]), bestDiff);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(distances[1]), bestSquare);
+
+        for (size_t b = 0; b < 8; b++) {
+            counts.sampleFrequency[indices[0][b]]++;
+            counts.squaredFrequency[indices[1][b]]++;
+            counts.sampleScore[indices[0][b]] += distances[0][b];
+            counts.squaredScore[indices[1][b]] += distances[1][b];
+        }
+    }
+
+    nearestTable<Classifier>(pixels + blocks * 24, count - blocks * 8, counts);
+}
+
+#endif
+
+Kernel bestKernel() {
+#ifdef PAINTINGS_X86_KERNELS
+    static const Kernel kernel = [] {
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports("avx512bw"))
+            return Kernel::AVX512;
+        if (__builtin_cpu_supports("avx2"))
+            return Kernel::AVX2;
+        if (__builtin_cpu_supports("sse4.1"))
+            return Kernel::SSE41;
+
+        return Kernel::Scalar;
+    }();
+
+    return kernel;
+#else
+    return Kernel::Scalar;
+#endif
+}
+
+const char *kernelName(Kernel kernel) {
+    switch (kernel) {
+        case Kernel::Scalar: return "scalar";
+        case Kernel::SSE41: return "sse4.1";
+        case Kernel::AVX2: return "avx2";
+        case Kernel::AVX512: return "avx512";
+    }
+
+    return "unknown";
+}
+
+template <typename Classifier>
+void classifyPixels(const uint8_t *pixels, size_t count, uint64_t *frequency, Kernel kernel) {
+    switch (kernel) {
+#ifdef PAINTINGS_X86_KERNELS
+        case Kernel::SSE41:
+            classifySSE41<Classifier>(pixels, count, frequency);
+            break;
+        case Kernel::AVX2:
+            classifyAVX2<Classifier>(pixels, count, frequency);
+            break;
+        case Kernel::AVX512:
+            classifyAVX512<Classifier>(pixels, count, frequency);
+            break;
+#endif
+        default:
+            classifyTable<Classifier>(pixels, count, frequency);
+            break;
+    }
+}
+
+template void classifyPixels<HueColors>(const uint8_t *, size_t, uint64_t *, Kernel);
+
+template <typename Classifier>
+void nearestPixels(const uint8_t *pixels, size_t count, const NearestCounts &counts, Kernel kernel) {
+    switch (kernel) {
+#ifdef PAINTINGS_X86_KERNELS
+        case Kernel::AVX2:
+        case Kernel::AVX512:
+            nearestAVX2<Classifier>(pixels, count, counts);
+            break;
+#endif
+        default:
+            nearestTable<Classifier>(pixels, count, counts);
+            break;
+    }
+}
+
+template void nearestPixels<TrueColors>(const uint8_t *, size_t, const NearestCounts &, Kernel);
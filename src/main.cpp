@@ -1,349 +1,272 @@
 #include <paintings/options.h>
 
+#include <paintings/ids.h>
 #include <paintings/pool.h>
+#include <paintings/sink.h>
+#include <paintings/journal.h>
+#include <paintings/sampler.h>
+#include <paintings/store.h>
+#include <paintings/cache.h>
+#include <paintings/download.h>
+#include <paintings/kernel.h>
+#include <paintings/buffers.h>
+#include <paintings/threads.h>
 #include <paintings/analysis.h>
 
-#include <nlohmann/json.hpp>
-
-#include <csv2/writer.hpp>
-
-#include <curl/curl.h>
-
 #include <fmt/printf.h>
 
-#include <random>
-#include <thread>
-#include <sstream>
+#include <cmath>
+#include <iostream>
+#include <unordered_map>
 
-using nlohmann::json;
+// Draws samples from results analyzed earlier, no network involved.
+struct Resampler {
+    std::vector<AnalysisResult> indexed;
+    std::vector<uint64_t> objectIds;
 
-std::string concatURL(const std::string &a, const std::string &b) {
-    return (a.substr(a.size() - 1, 1) == "/" && b.substr(0, 1) == "/") ? a + b.substr(1) : a + b;
-}
-
-void pushColors(std::vector<std::string> &vec) {
-    for (const std::string &sample : samples) {
-        vec.push_back(sample);
+    Resampler(const ResultStore &store, int32_t scale) {
+        indexed = store.results(scale, &objectIds);
     }
-}
-
-template <typename T>
-void pushValues(std::vector<std::string> &vec, const std::array<T, samples.size()> &values) {
-    for (T value : values)
-        vec.push_back(std::to_string(value));
-}
-
-void pushTable(std::vector<std::string> &vec, const char *name) {
-    vec.emplace_back("");
-    vec.emplace_back(name);
-    pushColors(vec);
-}
-
-template <typename T>
-void pushTableValues(std::vector<std::string> &vec, const std::array<T, samples.size()> &values) {
-    vec.emplace_back("");
-    vec.emplace_back("");
-    pushValues(vec, values);
-}
 
-struct SampleContext {
-    const std::vector<size_t> &ids;
+    // The results drawn, with the object ID of each into drawnIds.
+    std::vector<AnalysisResult> draw(size_t size, uint64_t seed, std::vector<size_t> &drawnIds) const {
+        ShuffledOrder order(indexed.size(), seed);
 
-    const size_t sampleSize = 0;
-    const std::string baseUrl;
+        std::vector<AnalysisResult> results;
+        results.reserve(size);
+        drawnIds.clear();
+        drawnIds.reserve(size);
 
-    std::mutex mutex;
-    std::vector<size_t> samplesPicked;
-    std::vector<AnalysisResult> results;
+        for (size_t index; results.size() < size && order.next(index);) {
+            results.push_back(indexed[index]);
+            drawnIds.push_back(objectIds[index]);
+        }
 
-    SampleContext(const std::vector<size_t> &ids, size_t sampleSize, std::string baseUrl)
-        : ids(ids), sampleSize(sampleSize), baseUrl(std::move(baseUrl)) {
-        samplesPicked.reserve(sampleSize);
-        results.reserve(sampleSize);
+        return results;
     }
 };
 
-size_t writeStream(void *buffer, size_t, size_t size, void *user) {
-    auto *stream = reinterpret_cast<std::stringstream *>(user);
-    stream->write(reinterpret_cast<char *>(buffer), size);
-
-    return size;
-}
-
-std::vector<size_t> getIds(const std::string &url) {
-    CURL *curl = curl_easy_init();
-
-    std::stringstream stream;
-
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &stream);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeStream);
-
-    curl_easy_perform(curl);
-    curl_easy_cleanup(curl);
-
-    std::vector<size_t> data;
-    json::parse(stream.str())["objectIDs"].get_to(data);
-
-    return data;
-}
-
-void workerThread(SampleContext *context) {
-    while (true) {
-        size_t objectId;
-
-        {
-            std::lock_guard lock(context->mutex);
-
-            if (context->results.size() >= context->sampleSize)
-                return;
-
-            std::random_device rd;
-            std::mt19937 generator(rd());
-            std::uniform_int_distribution<size_t> distribution(0, context->ids.size() - 1);
-
-            auto begin = context->samplesPicked.begin();
-            auto end = context->samplesPicked.end();
-
-            do {
-                objectId = context->ids[distribution(generator)];
-            } while (std::find(begin, end, objectId) != end);
+// Analyzes the same objects from both image tiers and reports, per class, how far each share from the small
+// image strays from the full size one's, so a run on small images comes with a known error.
+void calibrate(const Options &options, const ObjectIds &ids, ThreadPool *pool, DiskCache *cache, ResultStore *store,
+    Downloader &downloader) {
+    ObjectIds subset;
+    ShuffledOrder order(ids.size(), sampleSeed(options.seed, 0));
+
+    for (size_t index; subset.size() < options.sampleSize && order.next(index);)
+        subset.push_back(ids[index]);
+
+    Options full = options;
+    full.tier = Options::Tier::Full;
+
+    Options small = options;
+    small.tier = Options::Tier::Small;
+
+    std::vector<AnalysisResult> fullResults, smallResults;
+    std::vector<size_t> fullIds, smallIds;
+
+    auto keep = [](std::vector<AnalysisResult> &results, std::vector<size_t> &objectIds) {
+        return [&results, &objectIds](size_t, const PoolAccumulator &, std::vector<AnalysisResult> &&sample,
+            std::vector<size_t> &&ids) {
+            results = std::move(sample);
+            objectIds = std::move(ids);
+        };
+    };
+
+    fmt::print("Analyzing {} objects from full size images", subset.size());
+    runSamples(full, subset, pool, cache, store, nullptr, downloader, { options.seed }, true, true,
+        keep(fullResults, fullIds));
+    fmt::print("\nAnalyzing them again from small images");
+    runSamples(small, subset, pool, cache, store, nullptr, downloader, { options.seed }, true, true,
+        keep(smallResults, smallIds));
+    std::cout << std::endl;
+
+    std::unordered_map<size_t, const AnalysisResult *> fullById;
+    for (size_t a = 0; a < fullIds.size(); a++)
+        fullById[fullIds[a]] = &fullResults[a];
+
+    // Errors in class share, small minus full.
+    std::array<double, samples.size()> bias = { }, absolute = { }, squared = { }, worst = { };
+    double fullPixels = 0, smallPixels = 0;
+    size_t paired = 0;
+
+    for (size_t a = 0; a < smallIds.size(); a++) {
+        auto it = fullById.find(smallIds[a]);
+        if (it == fullById.end())
+            continue;
+
+        const AnalysisResult &reference = *it->second;
+        const AnalysisResult &result = smallResults[a];
+
+        for (size_t b = 0; b < samples.size(); b++) {
+            double error = result.normalized[b] - reference.normalized[b];
+
+            bias[b] += error;
+            absolute[b] += std::abs(error);
+            squared[b] += error * error;
+            worst[b] = std::max(worst[b], std::abs(error));
         }
 
-        std::unique_ptr<ImageData> image;
-
-        {
-            CURL *curl = curl_easy_init();
-            CURLcode error;
-
-            std::stringstream stream;
-
-            std::string objectUrl = concatURL(context->baseUrl, fmt::format("/objects/{}", objectId));
-            curl_easy_setopt(curl, CURLOPT_URL, objectUrl.c_str());
-            curl_easy_setopt(curl, CURLOPT_WRITEDATA, &stream);
-            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeStream);
-
-            error = curl_easy_perform(curl);
-            if (error != CURLE_OK) {
-                fmt::print("\nFailed to query object {}, resampling\n", objectUrl);
-                std::cout.flush();
-                continue;
-            }
-
-            std::string imageUrl;
-            auto obj = json::parse(stream.str());
-            if (!obj.contains("primaryImage")) {
-                fmt::print("\nFailed to parse query object {}, resampling\n", objectUrl);
-                std::cout.flush();
-                continue;
-            }
-
-            obj["primaryImage"].get_to(imageUrl);
-
-            if (imageUrl.empty()) {
-                fmt::print("\nFailed to find image url for query object {}, resampling\n", objectUrl);
-                std::cout.flush();
-                continue;
-            }
-
-            stream.str("");
-            stream.clear();
-
-            curl_easy_setopt(curl, CURLOPT_URL, imageUrl.c_str());
-
-            error = curl_easy_perform(curl);
-            if (error != CURLE_OK) {
-                fmt::print("\nFailed to query image data {}, resampling", imageUrl);
-                std::cout.flush();
-                continue;
-            }
-
-            curl_easy_cleanup(curl);
-
-            stream.seekg(0, std::ios::end);
-            std::vector<uint8_t> data(stream.tellg());
-            stream.seekg(0, std::ios::beg);
-            stream.read(reinterpret_cast<char *>(data.data()), data.size());
-
-            try {
-                image = std::make_unique<ImageData>(data.data(), data.size());
-            } catch (const std::runtime_error &error) {
-                fmt::print("\nFailed to parse image data {}, resampling", imageUrl);
-                std::cout.flush();
-                continue;
-            }
-        }
-
-        // Lock in the decision to use this sample now that everything has been downloaded with no problems.
-        {
-            std::lock_guard lock(context->mutex);
-
-            if (context->results.size() >= context->sampleSize)
-                return;
-
-            context->samplesPicked.push_back(objectId);
-        }
-
-        AnalysisResult result(*image);
-
-        {
-            std::lock_guard lock(context->mutex);
-
-            if (context->results.size() >= context->sampleSize)
-                return;
-
-            context->results.emplace_back(result);
-
-            if (context->results.size() % (context->sampleSize / 10) == 0)
-                std::cout << "." << std::flush; // for loading
-        }
+        fullPixels += static_cast<double>(reference.numPixels);
+        smallPixels += static_cast<double>(result.numPixels);
+        paired++;
     }
-}
 
-std::vector<AnalysisResult> runSample(const Options &options, const std::vector<size_t> &ids) {
-    SampleContext context(ids, options.sampleSize, options.url);
+    if (paired == 0)
+        throw std::runtime_error("No object could be analyzed from both image tiers.");
 
-    std::vector<std::thread> threads;
-    threads.reserve(options.threads);
+    fmt::print("Paired: {} of {} objects ({} full, {} small analyzed)\n",
+        paired, subset.size(), fullResults.size(), smallResults.size());
+    fmt::print("Pixels per image: {:.0f} full, {:.0f} small ({:.1f}%)\n",
+        fullPixels / paired, smallPixels / paired, 100 * smallPixels / std::max(fullPixels, 1.0));
+    fmt::print("\nShare error of small against full, percentage points:\n");
+    fmt::print("{:>10} {:>8} {:>8} {:>8} {:>8}\n", "Class", "Bias", "MAE", "RMS", "Max");
 
-    for (size_t b = 0; b < options.threads; b++)
-        threads.emplace_back(workerThread, &context);
-
-    for (std::thread &thread : threads)
-        thread.join();
-
-    return context.results;
+    for (size_t b = 0; b < samples.size(); b++) {
+        fmt::print("{:>10} {:>8.3f} {:>8.3f} {:>8.3f} {:>8.3f}\n", samples[b],
+            100 * bias[b] / paired, 100 * absolute[b] / paired, 100 * std::sqrt(squared[b] / paired), 100 * worst[b]);
+    }
 }
 
 int main(int count, const char **args) {
     try {
         Options options(count, args);
 
-        fmt::print("Downloading IDs...\n");
-        fmt::print("URL: {}\n", concatURL(options.url, "/search" + options.search));
-        std::vector<size_t> ids = getIds(concatURL(options.url, "/search" + options.search));
+        fmt::print("Classifier: {}\n", kernelName(bestKernel()));
 
-        if (options.raw) {
-            std::vector<std::vector<AnalysisResult>> allSamples(options.sampleCount);
+        BufferPool::global().setCapacity(options.bufferPool * 1024 * 1024);
 
-            for (size_t a = 0; a < options.sampleCount; a++) {
-                fmt::print("Starting sample {}", a + 1);
-                allSamples[a] = runSample(options, ids);
-                std::cout << std::endl;
-            }
+        std::unique_ptr<ThreadPool> threadPool;
+        if (options.imageThreads > 0)
+            threadPool = std::make_unique<ThreadPool>(options.imageThreads);
 
-            if (options.output.empty()) {
-                for (size_t a = 0; a < allSamples.size(); a++) {
-                    const auto &sample = allSamples[a];
-                    fmt::print("Sample #{}\n", a + 1);
-                    for (size_t b = 0; b < sample.size(); b++) {
-                        fmt::print("# Object {}\n{}\n", b + 1, sample[b].toString());
-                    }
-                }
-            } else {
-                fmt::print("Serializing...\n");
-                std::ofstream stream(options.output);
-                csv2::Writer writer(stream);
+        std::unique_ptr<DiskCache> cache;
+        if (!options.cacheDir.empty())
+            cache = std::make_unique<DiskCache>(options.cacheDir, options.cacheSize * 1024 * 1024);
 
-                std::vector<std::vector<std::string>> file;
+        std::unique_ptr<ResultStore> store;
+        if (!options.store.empty())
+            store = std::make_unique<ResultStore>(options.store);
 
-                size_t size;
+        RateController::Settings rate;
+        rate.maximum = options.connections;
+        rate.requestsPerSecond = options.maxRps;
+        rate.retries = options.retries;
 
-                {
-                    auto &header = file.emplace_back();
-                    header.emplace_back("Sample #");
-                    header.emplace_back("Object #");
-                    header.emplace_back("# Pixels");
+        Downloader downloader(rate);
 
-                    pushTable(header, "Frequencies");
-                    pushTable(header, "Normalized");
-
-                    size = header.size();
-                }
+        ObjectIds ids;
+        std::unique_ptr<Resampler> resampler;
 
-                for (size_t s = 0; s < allSamples.size(); s++) {
-                    const auto &sample = allSamples[s];
+        if (options.mode == Options::Mode::Resample) {
+            resampler = std::make_unique<Resampler>(*store, storeScale(options, options.tier != Options::Tier::Full));
+            fmt::print("Indexed Objects: {}\n", resampler->indexed.size());
 
-                    for (size_t a = 0; a < sample.size(); a++) {
-                        const auto &result = sample[a];
-
-                        auto &row = file.emplace_back();
-                        row.reserve(size);
-
-                        row.emplace_back(std::to_string(s + 1));
-                        row.emplace_back(std::to_string(a + 1));
-                        row.emplace_back(std::to_string(result.numPixels));
-
-                        pushTableValues(row, result.sampleFrequency);
-                        pushTableValues(row, result.normalized);
-                    }
-                }
-
-                writer.write_rows(file);
-            }
+            if (resampler->indexed.size() < options.sampleSize)
+                throw std::runtime_error("The store holds fewer objects than one sample needs.");
+        } else if (!options.idFile.empty()) {
+            ids = readIds(options.idFile);
+            fmt::print("IDs: {} from {}\n", ids.size(), options.idFile);
         } else {
-            std::vector<AnalysisPool> pools;
-            pools.reserve(options.sampleCount);
-
-            for (size_t a = 0; a < options.sampleCount; a++) {
-                fmt::print("Starting Sample {}", a + 1);
-
-                pools.emplace_back(runSample(options, ids));
-
-                std::cout << std::endl;
-            }
+            fmt::print("Downloading IDs...\n");
+            fmt::print("URL: {}\n", concatURL(options.url, "/search" + options.search));
+            ids = searchIds(downloader, concatURL(options.url, "/search" + options.search), options.cacheDir);
+        }
 
-            fmt::print("Done.\n");
+        // A resumed run goes on with the journal's seed, over the same IDs.
+        std::unique_ptr<Journal> journal;
+        if (!options.journal.empty()) {
+            journal = std::make_unique<Journal>(options.journal, options.resume, options.seed,
+                journalSettings(options, ids));
+            options.seed = journal->seed;
+        }
 
-            if (options.output.empty()) {
-                for (size_t a = 0; a < pools.size(); a++)
-                    fmt::print("# Sample {}\n{}\n", a + 1, pools[a].toString());
-            } else {
-                fmt::print("Serializing...\n");
-                std::ofstream stream(options.output);
-                csv2::Writer writer(stream);
+        fmt::print("Seed: {}\n", options.seed);
 
-                std::vector<std::vector<std::string>> file;
+        if (options.resume)
+            fmt::print("Resuming: {} objects from {}\n", journal->recovered.size(), options.journal);
 
-                size_t size;
+        if (options.mode == Options::Mode::Calibrate) {
+            calibrate(options, ids, threadPool.get(), cache.get(), store.get(), downloader);
+            fmt::print("{}\n", downloader.stats().toString());
 
-                {
-                    auto &header = file.emplace_back();
-                    header.emplace_back("Sample #");
-                    header.emplace_back("# Pictures");
-                    header.emplace_back("# Pixels");
+            return 0;
+        }
 
-                    pushTable(header, "Frequencies");
-                    pushTable(header, "Raw");
-                    pushTable(header, "Average");
-                    pushTable(header, "Min");
-                    pushTable(header, "Max");
-                    pushTable(header, "S.D.");
+        if (options.mode == Options::Mode::Index) {
+            fmt::print("Indexing {} objects", ids.size());
+            size_t analyzed = 0;
+            auto tally = [&analyzed](size_t, const PoolAccumulator &pool, std::vector<AnalysisResult> &&,
+                std::vector<size_t> &&) {
+                analyzed = pool.count;
+            };
+            runSamples(options, ids, threadPool.get(), cache.get(), store.get(), nullptr, downloader,
+                { options.seed }, true, false, tally);
+            fmt::print("\nAnalyzed {} objects, {} now in the store.\n", analyzed, store->size());
+            fmt::print("{}\n", BufferPool::global().stats().toString());
+            fmt::print("{}\n", downloader.stats().toString());
+
+            return 0;
+        }
 
-                    size = header.size();
+        // Each sample draws from its own seed, so a run's samples are reproducible one by one.
+        std::vector<uint64_t> seeds(options.sampleCount);
+        for (size_t a = 0; a < options.sampleCount; a++)
+            seeds[a] = sampleSeed(options.seed, a);
+
+        std::unique_ptr<ResultSink> sink;
+        if (!options.output.empty())
+            sink = openSink(options.format, options.output, options.raw, options.approximate > 0);
+
+        // Each sample is written as soon as it's complete, and flushed so it's on disk whatever happens later. Only
+        // raw output needs the results themselves, pooled output goes by the sample's accumulator.
+        auto write = [&](size_t a, const PoolAccumulator &accumulator, std::vector<AnalysisResult> &&results,
+            std::vector<size_t> &&objectIds) {
+            if (options.raw) {
+                if (!sink)
+                    fmt::print("\nSample #{}\n", a + 1);
+
+                for (size_t b = 0; b < results.size(); b++) {
+                    if (sink)
+                        sink->write(a, b, objectIds[b], results[b]);
+                    else
+                        fmt::print("# Object {}\n{}\n", b + 1, results[b].toString());
                 }
+            } else {
+                AnalysisPool pool(accumulator);
 
-                for (size_t a = 0; a < pools.size(); a++) {
-                    const auto &pool = pools[a];
+                if (sink)
+                    sink->write(a, pool);
+                else
+                    fmt::print("\n# Sample {}\n{}\n", a + 1, pool.toString());
+            }
 
-                    auto &row = file.emplace_back();
-                    row.reserve(size);
+            if (sink)
+                sink->flush();
+        };
 
-                    row.emplace_back(std::to_string(a + 1));
-                    row.emplace_back(std::to_string(pool.totalPictures));
-                    row.emplace_back(std::to_string(pool.totalPixels));
+        if (resampler) {
+            for (size_t a = 0; a < seeds.size(); a++) {
+                std::vector<size_t> objectIds;
+                std::vector<AnalysisResult> results = resampler->draw(options.sampleSize, seeds[a], objectIds);
+                PoolAccumulator accumulator;
 
-                    pushTableValues(row, pool.rawFrequency);
-                    pushTableValues(row, pool.rawNormalized);
-                    pushTableValues(row, pool.avgNormal);
-                    pushTableValues(row, pool.minNormal);
-                    pushTableValues(row, pool.maxNormal);
-                    pushTableValues(row, pool.standardDeviation);
-                }
+                for (const AnalysisResult &result : results)
+                    accumulator.add(result);
 
-                writer.write_rows(file);
+                write(a, accumulator, std::move(results), std::move(objectIds));
             }
+        } else {
+            fmt::print("Sampling {} x {} objects", options.sampleCount, options.sampleSize);
+            runSamples(options, ids, threadPool.get(), cache.get(), store.get(), journal.get(), downloader, seeds,
+                false, options.raw, write);
+            std::cout << std::endl;
         }
+
+        fmt::print("Done.\n");
+
+        fmt::print("{}\n", BufferPool::global().stats().toString());
+        fmt::print("{}\n", downloader.stats().toString());
     } catch (const std::runtime_error &e) {
         fmt::print("ERROR: {}\n", e.what());
         return 1;
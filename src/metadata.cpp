@@ -0,0 +1,119 @@
+#include <paintings/metadata.h>
+
+#include <nlohmann/json.hpp>
+
+using nlohmann::json;
+
+namespace {
+    // Only top level keys count, nested objects like constituents have fields of their own.
+    struct MetadataHandler : nlohmann::json_sax<json> {
+        enum Field : uint32_t {
+            None = 0,
+            PrimaryImage = 1,
+            PrimaryImageSmall = 2,
+            Dimensions = 4,
+            PublicDomain = 8,
+            All = 15,
+        };
+
+        ObjectMetadata &metadata;
+
+        size_t depth = 0;
+        Field current = None;
+        uint32_t found = 0;
+        bool failed = false;
+
+        explicit MetadataHandler(ObjectMetadata &metadata) : metadata(metadata) { }
+
+        // Returning false ends the parse, which is what happens once every field is in.
+        bool take(Field field) {
+            found |= field;
+            current = None;
+
+            return found != All;
+        }
+
+        bool string(string_t &value) override {
+            if (depth != 1)
+                return true;
+
+            switch (current) {
+            case PrimaryImage:
+                metadata.primaryImage = value;
+                return take(PrimaryImage);
+            case PrimaryImageSmall:
+                metadata.primaryImageSmall = value;
+                return take(PrimaryImageSmall);
+            case Dimensions:
+                metadata.dimensions = value;
+                return take(Dimensions);
+            default:
+                return true;
+            }
+        }
+
+        bool boolean(bool value) override {
+            if (depth != 1 || current != PublicDomain)
+                return true;
+
+            metadata.isPublicDomain = value;
+            return take(PublicDomain);
+        }
+
+        bool key(string_t &value) override {
+            if (depth != 1)
+                return true;
+
+            if (value == "primaryImage")
+                current = PrimaryImage;
+            else if (value == "primaryImageSmall")
+                current = PrimaryImageSmall;
+            else if (value == "dimensions")
+                current = Dimensions;
+            else if (value == "isPublicDomain")
+                current = PublicDomain;
+            else
+                current = None;
+
+            return true;
+        }
+
+        bool null() override { return true; }
+        bool number_integer(number_integer_t) override { return true; }
+        bool number_unsigned(number_unsigned_t) override { return true; }
+        bool number_float(number_float_t, const string_t &) override { return true; }
+        bool binary(binary_t &) override { return true; }
+
+        bool start_object(size_t) override {
+            depth++;
+            return true;
+        }
+
+        bool end_object() override {
+            depth--;
+            return true;
+        }
+
+        bool start_array(size_t) override {
+            depth++;
+            return true;
+        }
+
+        bool end_array() override {
+            depth--;
+            return true;
+        }
+
+        bool parse_error(size_t, const std::string &, const nlohmann::detail::exception &) override {
+            failed = true;
+            return false;
+        }
+    };
+}
+
+bool parseMetadata(const uint8_t *data, size_t size, ObjectMetadata &metadata) {
+    MetadataHandler handler(metadata);
+    json::sax_parse(data, data + size, &handler);
+
+    return !handler.failed;
+}
@@ -4,20 +4,99 @@
 #include <CLI/Config.hpp>
 #include <CLI/Formatter.hpp>
 
+#include <random>
+
 Options::Options(int count, const char **args) {
     CLI::App app("Hue analyzer for images.");
 
+    std::random_device device;
+    seed = static_cast<uint64_t>(device()) << 32 | device();
+
+    CLI::App *index = app.add_subcommand("index", "Analyze every object matching the search into --store.");
+    CLI::App *resample = app.add_subcommand("resample", "Draw samples from --store without downloading anything.");
+    CLI::App *calibrate = app.add_subcommand("calibrate",
+        "Analyze --sample-size objects from both image tiers and report how far small strays from full.");
+    index->fallthrough();
+    resample->fallthrough();
+    calibrate->fallthrough();
+
+    std::string tierName = "full";
+
     app.add_option("-u,--url", url, "Base URL for MET API.");
     app.add_option("-s,--search", search, "Postfix for search query.");
-    app.add_option("-t,--threads", threads, "Number of threads per sample.");
+    app.add_option("--ids", idFile, "File of object IDs to sample from instead of searching, one per line.");
+    app.add_option("-t,--threads", threads, "Threads decoding and classifying images, unless set per stage.");
+    app.add_option("--parse-workers", parseWorkers, "Threads parsing object metadata and loading cached images.");
+    app.add_option("--decode-workers", decodeWorkers, "Threads decoding images.");
+    app.add_option("--classify-workers", classifyWorkers, "Threads classifying decoded images.");
+    app.add_option("--queue-size", queueSize, "Objects waiting between two stages before the earlier one blocks.");
+    app.add_flag("--stage-report", stageReport, "Print how backed up each stage's queue was after every sample.");
+    app.add_option("--connections", connections,
+        "Most requests in flight at once, metadata and images together, fewer while the server is throttling or "
+        "slowing down.");
+    app.add_option("--max-rps", maxRps, "Most requests started per second, no limit when zero.");
+    app.add_option("--retries", retries, "Times a throttled or timed out request is tried again before resampling.");
+    app.add_option("-j,--image-threads", imageThreads, "Extra threads for splitting up large images.");
     app.add_option("-n,--sample-size", sampleSize, "Size of each sample.");
     app.add_option("-c,--sample-count", sampleCount, "Number of samples to be made.");
-    app.add_option("-o,--output", output, "Optional output CSV file.");
+    CLI::Option *seedOption = app.add_option("--seed", seed,
+        "Seed for picking samples, the same seed picks the same objects.");
+    app.add_option("-a,--approximate", approximate,
+        "Classify random pixels until every class share has a 95% interval narrower than this.");
+    app.add_option("-o,--output", output, "Optional output file, written as samples complete.");
+    app.add_option("--format", format,
+        "Output file format: csv, ndjson (one JSON object per line) or columns (binary columnar, --raw only).")
+        ->check(CLI::IsMember({ "csv", "ndjson", "columns" }));
     app.add_flag("--raw", raw, "Whether to give all data or summary.");
+    app.add_option("--image-tier", tierName,
+        "Image to analyze: full, small (primaryImageSmall) or small-or-full, full where an object has no small one.")
+        ->check(CLI::IsMember({ "full", "small", "small-or-full" }));
+    app.add_option("--decode-scale", decodeScale, "Decode images at 1/2, 1/4 or 1/8 size for a faster histogram.")
+        ->check(CLI::IsMember({ 1, 2, 4, 8 }));
+    app.add_option("--cache-dir", cacheDir, "Directory for keeping downloaded images between samples and runs.");
+    app.add_option("--cache-size", cacheSize, "MiB the image cache may grow to before the least recently used go.");
+    app.add_option("--store", store, "Result store file, objects already in it are not downloaded again."
+        " Only one process can have it open at a time.");
+    app.add_option("--journal", journal, "File logging every finished object, so a run that dies can be resumed.");
+    app.add_flag("--resume", resume, "Go on with the run in --journal, only objects it doesn't hold are fetched.")
+        ->excludes(seedOption);
+    app.add_option("--buffer-pool", bufferPool, "MiB of decoded image buffers kept for reuse between images.");
+    app.add_flag("--stream", stream, "Decode and classify images a few rows at a time (ignores --approximate).");
 
     try {
         app.parse(count, args);
     } catch (const CLI::ParseError &e) {
         throw std::runtime_error(e.what());
     }
+
+    if (*index)
+        mode = Mode::Index;
+    else if (*resample)
+        mode = Mode::Resample;
+    else if (*calibrate)
+        mode = Mode::Calibrate;
+
+    if (tierName == "small")
+        tier = Tier::Small;
+    else if (tierName == "small-or-full")
+        tier = Tier::SmallOrFull;
+
+    // Nothing would ever go through a stage or queue of size zero, the run would wait forever.
+    if (threads == 0 || connections == 0 || queueSize == 0)
+        throw std::runtime_error("--threads, --connections and --queue-size need to be at least 1.");
+
+    if ((mode == Mode::Index || mode == Mode::Resample) && store.empty())
+        throw std::runtime_error("index and resample need a --store file.");
+
+    if (resume && journal.empty())
+        throw std::runtime_error("--resume needs the --journal of the run.");
+
+    if (!journal.empty() && mode != Mode::Sample)
+        throw std::runtime_error("Only sampling runs keep a --journal.");
+
+    if (format == "columns" && !raw)
+        throw std::runtime_error("--format columns only holds raw results, add --raw.");
+
+    if (mode == Mode::Index && approximate > 0)
+        throw std::runtime_error("index only stores exact results, leave out --approximate.");
 }
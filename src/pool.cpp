@@ -2,6 +2,10 @@
 
 #include <fmt/format.h>
 
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
 std::string AnalysisPool::toString() const {
     return fmt::format(
         "Total Pictures: {}\n"
@@ -22,55 +26,110 @@ std::string AnalysisPool::toString() const {
         join(standardDeviation));
 }
 
-AnalysisPool::AnalysisPool(const std::vector<AnalysisResult> &results) {
-    if (results.empty())
-        return;
-
-    totalPictures = results.size();
+PoolAccumulator::PoolAccumulator(bool quantiles) {
+    if (quantiles)
+        sketches.resize(samples.size());
+}
 
-    for (const AnalysisResult &result : results) {
-        totalPixels += result.numPixels;
+void PoolAccumulator::add(const AnalysisResult &result) {
+    count++;
+    pixels += result.numPixels;
 
-        auto normal = result.normalized;
+    const auto &normals = result.normalized;
 
-        for (size_t a = 0; a < samples.size(); a++) {
-            rawFrequency[a] += result.sampleFrequency[a];
-            avgNormal[a] += normal[a];
-        }
+    if (count == 1) {
+        min = normals;
+        max = normals;
     }
 
-    auto normalize = [this](uint64_t i) {
-        return static_cast<double>(i) / static_cast<double>(totalPixels);
-    };
+    for (size_t a = 0; a < samples.size(); a++) {
+        frequency[a] += result.sampleFrequency[a];
+        sum[a] += normals[a];
 
-    std::transform(rawFrequency.begin(), rawFrequency.end(), rawNormalized.begin(), normalize);
+        if (min[a] > normals[a])
+            min[a] = normals[a];
+
+        if (max[a] < normals[a])
+            max[a] = normals[a];
 
-    for (double &normal : avgNormal) {
-        normal /= static_cast<double>(totalPictures);
+        double before = normals[a] - mean[a];
+        mean[a] += before / static_cast<double>(count);
+        squares[a] += before * (normals[a] - mean[a]);
     }
 
-    minNormal = results.front().normalized;
-    maxNormal = minNormal;
+    for (size_t a = 0; a < sketches.size(); a++)
+        sketches[a].add(normals[a]);
+}
+
+void PoolAccumulator::merge(const PoolAccumulator &other) {
+    if (other.count == 0)
+        return;
+
+    double before = static_cast<double>(count);
+    double added = static_cast<double>(other.count);
+    double total = before + added;
 
-    // Second pass for min/max normals and SD
-    for (const AnalysisResult &result : results) {
-        auto normals = result.normalized;
+    for (size_t a = 0; a < samples.size(); a++) {
+        frequency[a] += other.frequency[a];
+        sum[a] += other.sum[a];
 
-        for (size_t a = 0; a < samples.size(); a++) {
-            if (minNormal[a] > normals[a])
-                minNormal[a] = normals[a];
+        if (count == 0 || min[a] > other.min[a])
+            min[a] = other.min[a];
 
-            if (maxNormal[a] < normals[a])
-                maxNormal[a] = normals[a];
+        if (count == 0 || max[a] < other.max[a])
+            max[a] = other.max[a];
 
-            double diffMean = normals[a] - avgNormal[a];
-            standardDeviation[a] += diffMean * diffMean;
-        }
+        double delta = other.mean[a] - mean[a];
+        squares[a] += other.squares[a] + delta * delta * before * added / total;
+        mean[a] += delta * added / total;
     }
 
-    if (results.size() >= 2) {
-        for (double &sd : standardDeviation) {
-            sd = std::sqrt(sd / (totalPictures - 1.0));
-        }
+    // Sketches are only merged into an accumulator that keeps them.
+    for (size_t a = 0; a < sketches.size() && a < other.sketches.size(); a++)
+        sketches[a].merge(other.sketches[a]);
+
+    count += other.count;
+    pixels += other.pixels;
+}
+
+double PoolAccumulator::quantile(size_t type, double q) const {
+    if (sketches.empty())
+        throw std::runtime_error("Quantiles need an accumulator made with quantiles.");
+
+    return sketches[type].quantile(q);
+}
+
+AnalysisPool::AnalysisPool(const std::vector<AnalysisResult> &results) : AnalysisPool([&results] {
+    PoolAccumulator accumulator;
+
+    for (const AnalysisResult &result : results)
+        accumulator.add(result);
+
+    return accumulator;
+}()) { }
+
+AnalysisPool::AnalysisPool(const PoolAccumulator &accumulator) {
+    if (accumulator.count == 0)
+        return;
+
+    totalPictures = accumulator.count;
+    totalPixels = accumulator.pixels;
+    rawFrequency = accumulator.frequency;
+
+    auto normalize = [this](uint64_t i) {
+        return static_cast<double>(i) / static_cast<double>(totalPixels);
+    };
+
+    std::transform(rawFrequency.begin(), rawFrequency.end(), rawNormalized.begin(), normalize);
+
+    for (size_t a = 0; a < samples.size(); a++)
+        avgNormal[a] = accumulator.sum[a] / static_cast<double>(totalPictures);
+
+    minNormal = accumulator.min;
+    maxNormal = accumulator.max;
+
+    if (totalPictures >= 2) {
+        for (size_t a = 0; a < samples.size(); a++)
+            standardDeviation[a] = std::sqrt(accumulator.squares[a] / (totalPictures - 1.0));
     }
 }
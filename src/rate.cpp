@@ -0,0 +1,134 @@
+#include <paintings/rate.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+
+std::string RateController::Stats::toString() const {
+    return fmt::format("Requests: {} ({} throttled, {} failed), {} backoffs, {:.1f} in flight at the end, {:.1f} peak, "
+        "{}", requests, throttled, failed, decreases, window, peakWindow,
+        pace > 0 ? fmt::format("paced at {:.1f}/s", pace) : std::string("unpaced"));
+}
+
+RateController::RateController(const Settings &settings) : config(settings) {
+    config.minimum = std::max<size_t>(config.minimum, 1);
+    config.maximum = std::max(config.maximum, config.minimum);
+
+    window = static_cast<double>(std::clamp(config.initial, config.minimum, config.maximum));
+    threshold = static_cast<double>(config.maximum);
+
+    tokens = 1;
+    refilled = Clock::now();
+
+    totals.window = totals.peakWindow = window;
+}
+
+double RateController::ceiling() const {
+    if (config.requestsPerSecond > 0 && pace > 0)
+        return std::min(config.requestsPerSecond, pace);
+
+    return std::max(config.requestsPerSecond, pace);
+}
+
+void RateController::refill(Clock::time_point now) {
+    double elapsed = std::chrono::duration<double>(now - refilled).count();
+    refilled = now;
+
+    tokens = std::min(tokens + elapsed * ceiling(), std::max(ceiling() / 10, 1.0));
+}
+
+bool RateController::admit(size_t active, Clock::time_point now) {
+    if (static_cast<double>(active) + 1 > window)
+        return false;
+
+    if (ceiling() <= 0)
+        return true;
+
+    refill(now);
+
+    if (tokens < 1)
+        return false;
+
+    tokens -= 1;
+
+    return true;
+}
+
+RateController::Clock::duration RateController::wait(Clock::time_point now) const {
+    double rate = ceiling();
+    if (rate <= 0)
+        return Clock::duration::zero();
+
+    double available = tokens + std::chrono::duration<double>(now - refilled).count() * rate;
+    if (available >= 1)
+        return Clock::duration::zero();
+
+    return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>((1 - available) / rate));
+}
+
+void RateController::decrease() {
+    if (holdoff > 0)
+        return;
+
+    holdoff = window;
+
+    // A server limiting requests per second keeps throttling however few are in flight once they're answered
+    // quickly enough, so the pace is cut too. Without one yet, the rate the window allowed is where it starts.
+    double rate = pace > 0 ? pace : window / std::max(std::chrono::duration<double>(smoothed).count(), 1e-3);
+    pace = std::max(rate * config.decrease, 1.0);
+
+    threshold = std::max(window * config.decrease, static_cast<double>(config.minimum));
+    window = threshold;
+
+    totals.decreases++;
+}
+
+void RateController::complete(Outcome outcome, Clock::duration firstByte) {
+    totals.requests++;
+    holdoff = std::max(holdoff - 1, 0.0);
+
+    if (outcome == Outcome::Throttled) {
+        totals.throttled++;
+        decrease();
+    } else if (outcome == Outcome::Failed) {
+        // Missing objects and the like say nothing about load.
+        totals.failed++;
+    } else {
+        smoothed = smoothed == Clock::duration::zero() ? firstByte : smoothed + (firstByte - smoothed) / 8;
+
+        // The best creeps up towards what's seen now, so one lucky response doesn't hold the window down for good.
+        best = firstByte < best ? firstByte : best + (firstByte - best) / 256;
+
+        if (smoothed > best * config.latencyFactor) {
+            decrease();
+        } else {
+            if (window < threshold)
+                window += 1;
+            else
+                window += 1 / window;
+
+            // The pace goes up by ten requests per second every second it holds, and is dropped once the window
+            // alone holds the rate well below it.
+            if (pace > 0) {
+                pace += 10 / pace;
+
+                if (pace > 2 * window / std::max(std::chrono::duration<double>(smoothed).count(), 1e-3))
+                    pace = 0;
+            }
+        }
+
+        window = std::min(window, static_cast<double>(config.maximum));
+    }
+
+    totals.window = window;
+    totals.pace = pace;
+    totals.peakWindow = std::max(totals.peakWindow, window);
+}
+
+RateController::Clock::duration RateController::retryDelay(size_t attempt) const {
+    return std::chrono::milliseconds(250) * (1 << std::min<size_t>(attempt, 5));
+}
+
+RateController::Stats RateController::stats() const {
+    return totals;
+}
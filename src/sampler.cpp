@@ -0,0 +1,617 @@
+#include <paintings/sampler.h>
+
+#include <paintings/store.h>
+#include <paintings/cache.h>
+#include <paintings/queue.h>
+#include <paintings/journal.h>
+#include <paintings/metadata.h>
+#include <paintings/download.h>
+#include <paintings/threads.h>
+
+#include <curl/curl.h>
+
+#include <fmt/printf.h>
+
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <algorithm>
+#include <unordered_map>
+#include <thread>
+#include <condition_variable>
+
+std::string concatURL(const std::string &a, const std::string &b) {
+    return (a.substr(a.size() - 1, 1) == "/" && b.substr(0, 1) == "/") ? a + b.substr(1) : a + b;
+}
+
+uint64_t sampleSeed(uint64_t seed, uint64_t sample) {
+    uint64_t z = seed + (sample + 1) * 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+
+    return z ^ (z >> 31);
+}
+
+// All samples run together as one pipeline: IDs are picked here, then metadata is fetched and parsed, the image
+// fetched, decoded and classified, and one thread aggregates. Fetches go through the Downloader's callbacks, one
+// thread per fetch stage only starts them, so as many are in flight as the downloader allows. Parse, decode and
+// classify have their own worker threads. Stages are linked by bounded queues, so a slow stage backs the ones
+// before it up instead of piling up work. An object picked by several samples goes through once and its result is
+// handed to each of them.
+struct SampleContext {
+    // An object on its way through the stages, each one fills in a bit more.
+    struct Item {
+        size_t objectId = 0;
+        std::string imageUrl;
+
+        // Whether imageUrl is primaryImageSmall.
+        bool small = false;
+
+        // The metadata, then the image's compressed bytes.
+        std::vector<uint8_t> data;
+
+        // The last fetch failed, the stage after it gives up on the object.
+        bool failed = false;
+
+        // The image came from the network rather than the cache, the decode stage caches it.
+        bool downloaded = false;
+
+        // Streaming decodes happen in the classify stage, the reader reads out of data.
+        std::optional<ImageData> image;
+        std::unique_ptr<ImageReader> reader;
+
+        AnalysisResult result;
+    };
+
+    struct Sample {
+        ShuffledOrder order;
+
+        // Candidates waiting on an object still in the pipeline.
+        size_t pending = 0;
+
+        struct Entry {
+            size_t rank;
+            size_t objectId;
+            AnalysisResult result;
+        };
+
+        // Every result handed to the sample so far.
+        PoolAccumulator pool;
+
+        // Ranked by candidate order, so a seed gives the same sample in the same order every time. Only kept when
+        // the results are wanted, not just the pool.
+        std::vector<Entry> results;
+
+        // Out of candidates, it stays short of the target.
+        bool exhausted = false;
+
+        Sample(size_t size, uint64_t seed) : order(size, seed) { }
+
+        bool complete(size_t target) const {
+            return pending == 0 && (pool.count >= target || exhausted);
+        }
+    };
+
+    struct Object {
+        enum class State { Running, Done, Failed };
+
+        State state = State::Running;
+        AnalysisResult result;
+
+        // (sample, rank) of every candidate waiting for this object while it runs.
+        std::vector<std::pair<size_t, size_t>> waiting;
+    };
+
+    const Options &options;
+    const ObjectIds &ids;
+
+    ThreadPool *pool = nullptr;
+    DiskCache *cache = nullptr;
+    ResultStore *store = nullptr;
+    Journal *journal = nullptr;
+    Downloader *downloader = nullptr;
+
+    // Exhaustive contexts go through every ID in order instead of drawing sampleSize of them at random.
+    bool exhaustive = false;
+    bool keepResults = false;
+    size_t target = 0;
+
+    // Inputs of the metadata fetch, parse, image fetch, decode, classify and aggregate stages. A fetch holds a
+    // place in the queue after it from when it starts, so queried and fetched also bound the requests in flight.
+    BoundedQueue<Item> picked;
+    BoundedQueue<Item> queried;
+    BoundedQueue<Item> described;
+    BoundedQueue<Item> fetched;
+    BoundedQueue<Item> decoded;
+    BoundedQueue<Item> classified;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+
+    std::vector<Sample> samples;
+    std::unordered_map<size_t, Object> objects;
+
+    // Objects in the pipeline, and results handed to samples so far (for the progress dots).
+    size_t running = 0;
+    size_t attached = 0;
+
+    // Samples handed on so far, always the first ones.
+    size_t finished = 0;
+
+    // Fetches whose callbacks haven't run yet, the context has to outlive them.
+    size_t requests = 0;
+
+    // Set by a stage that can't go on (the journal or store failing to write), the run stops over it.
+    std::string error;
+
+    // Decoded images are whole frames, so that queue only holds one per classify thread. Fetches have room for
+    // every connection on top of the queue size, so they keep the downloader busy.
+    SampleContext(const Options &options, const ObjectIds &ids, ThreadPool *pool, DiskCache *cache,
+        ResultStore *store, Journal *journal, Downloader *downloader, const std::vector<uint64_t> &seeds,
+        bool exhaustive, bool keepResults)
+        : options(options), ids(ids), pool(pool), cache(cache), store(store), journal(journal), downloader(downloader),
+        exhaustive(exhaustive), keepResults(keepResults), target(exhaustive ? ids.size() : options.sampleSize),
+        picked(options.queueSize), queried(options.queueSize + options.connections), described(options.queueSize),
+        fetched(options.queueSize + options.connections), decoded(options.workers(options.classifyWorkers)),
+        classified(options.queueSize) {
+        samples.reserve(seeds.size());
+
+        for (uint64_t seed : seeds)
+            samples.emplace_back(ids.size(), seed);
+    }
+
+    // Hands a finished object to one of the samples waiting on it. Called with the context locked.
+    void attach(size_t sample, size_t rank, size_t objectId, const AnalysisResult &result) {
+        samples[sample].pool.add(result);
+        if (keepResults)
+            samples[sample].results.push_back({ rank, objectId, result });
+
+        attached++;
+
+        if (attached % std::max<size_t>(target * samples.size() / 10, 1) == 0)
+            std::cout << "." << std::flush; // for loading
+    }
+};
+
+int32_t storeScale(const Options &options, bool small) {
+    return small ? -options.decodeScale : options.decodeScale;
+}
+
+std::string journalSettings(const Options &options, const ObjectIds &ids) {
+    // FNV-1a over the IDs, a list that changed since the journal was started picks other samples.
+    uint64_t hash = 14695981039346656037ull;
+
+    for (uint32_t id : ids) {
+        for (size_t a = 0; a < sizeof(id); a++) {
+            hash ^= (id >> (8 * a)) & 0xFF;
+            hash *= 1099511628211ull;
+        }
+    }
+
+    return fmt::format("{} {} {} {} {} {} {} {} {:016x}", options.url, options.idFile.empty() ? options.search : "",
+        options.idFile, static_cast<int>(options.tier), options.decodeScale, options.approximate, options.stream,
+        classifierVersion, hash ^ ids.size());
+}
+
+// Small or full falls back to a full size result, which is at least as good, when there's no small one.
+static bool findStored(const Options &options, const ResultStore *store, size_t objectId, AnalysisResult &result) {
+    if (!store)
+        return false;
+
+    if (options.tier != Options::Tier::Full && store->find(objectId, storeScale(options, true), result))
+        return true;
+
+    return options.tier != Options::Tier::Small && store->find(objectId, storeScale(options, false), result);
+}
+
+// Picks a sample's next candidate, false once there are none left. Only runSamples' own thread picks.
+static bool pickObject(SampleContext &context, SampleContext::Sample &sample, size_t &rank, size_t &objectId) {
+    ShuffledOrder &order = sample.order;
+    rank = order.drawn;
+
+    size_t index;
+
+    if (context.exhaustive) {
+        if (order.drawn >= context.ids.size())
+            return false;
+
+        index = order.drawn++;
+    } else if (!order.next(index)) {
+        return false;
+    }
+
+    objectId = context.ids[index];
+
+    return true;
+}
+
+// Stops the run, runSamples throws the first error once every stage is down.
+static void failRun(SampleContext *context, const std::string &error) {
+    {
+        std::lock_guard lock(context->mutex);
+
+        if (context->error.empty())
+            context->error = error;
+    }
+
+    context->changed.notify_all();
+}
+
+// Gives up on an object, every sample waiting on it picks another candidate in its place.
+static void abandonObject(SampleContext *context, size_t objectId) {
+    try {
+        if (context->journal)
+            context->journal->fail(objectId);
+    } catch (const std::runtime_error &error) {
+        failRun(context, error.what());
+    }
+
+    {
+        std::lock_guard lock(context->mutex);
+
+        SampleContext::Object &object = context->objects[objectId];
+        object.state = SampleContext::Object::State::Failed;
+
+        for (auto [sample, rank] : object.waiting)
+            context->samples[sample].pending--;
+
+        object.waiting.clear();
+        context->running--;
+    }
+
+    context->changed.notify_all();
+}
+
+// Starts a fetch whose response goes on into `next`, in the place it already holds there. The callback runs on
+// the download thread, so it only hands the item on.
+static void fetch(SampleContext *context, const std::string &url, SampleContext::Item &&item,
+    BoundedQueue<SampleContext::Item> &next) {
+    {
+        std::lock_guard lock(context->mutex);
+        context->requests++;
+    }
+
+    auto held = std::make_shared<SampleContext::Item>(std::move(item));
+
+    context->downloader->get(url, [context, held, &next](Downloader::Response &&response) {
+        held->failed = response.error != CURLE_OK || response.body.empty();
+        held->data = std::move(response.body);
+
+        next.pushReserved(std::move(*held));
+
+        // Notified under the lock, runSamples may return as soon as it sees the count drop.
+        std::lock_guard lock(context->mutex);
+        context->requests--;
+        context->changed.notify_all();
+    });
+}
+
+static std::string objectUrl(const SampleContext *context, size_t objectId) {
+    return concatURL(context->options.url, fmt::format("/objects/{}", objectId));
+}
+
+static void metadataThread(SampleContext *context) {
+    while (auto item = context->picked.pop()) {
+        if (!context->queried.reserve())
+            return;
+
+        fetch(context, objectUrl(context, item->objectId), std::move(*item), context->queried);
+    }
+}
+
+static void parseThread(SampleContext *context) {
+    while (auto item = context->queried.pop()) {
+        std::string url = objectUrl(context, item->objectId);
+
+        if (item->failed) {
+            fmt::print("\nFailed to query object {}, resampling\n", url);
+            std::cout.flush();
+            abandonObject(context, item->objectId);
+            continue;
+        }
+
+        ObjectMetadata metadata;
+
+        if (!parseMetadata(item->data.data(), item->data.size(), metadata)) {
+            fmt::print("\nFailed to parse query object {}, resampling\n", url);
+            std::cout.flush();
+            abandonObject(context, item->objectId);
+            continue;
+        }
+
+        if (context->options.tier != Options::Tier::Full && !metadata.primaryImageSmall.empty()) {
+            item->imageUrl = std::move(metadata.primaryImageSmall);
+            item->small = true;
+        } else if (context->options.tier != Options::Tier::Small) {
+            item->imageUrl = std::move(metadata.primaryImage);
+        }
+
+        if (item->imageUrl.empty()) {
+            fmt::print("\nFailed to find image url for query object {}, resampling\n", url);
+            std::cout.flush();
+            abandonObject(context, item->objectId);
+            continue;
+        }
+
+        // Cached images skip the image fetch.
+        item->data.clear();
+
+        if (context->cache && context->cache->load(item->objectId, item->imageUrl, item->data))
+            context->fetched.push(std::move(*item));
+        else
+            context->described.push(std::move(*item));
+    }
+}
+
+static void imageThread(SampleContext *context) {
+    while (auto item = context->described.pop()) {
+        if (!context->fetched.reserve())
+            return;
+
+        std::string url = item->imageUrl;
+        item->downloaded = true;
+
+        fetch(context, url, std::move(*item), context->fetched);
+    }
+}
+
+static void decodeThread(SampleContext *context) {
+    while (auto item = context->fetched.pop()) {
+        if (item->failed) {
+            fmt::print("\nFailed to query image data {}, resampling", item->imageUrl);
+            std::cout.flush();
+            abandonObject(context, item->objectId);
+            continue;
+        }
+
+        if (context->cache && item->downloaded)
+            context->cache->store(item->objectId, item->imageUrl, item->data);
+
+        try {
+            if (context->options.stream)
+                item->reader = ImageReader::open(item->data.data(), item->data.size(), context->options.decodeScale);
+            else
+                item->image.emplace(item->data.data(), item->data.size(), context->options.decodeScale);
+        } catch (const std::runtime_error &error) {
+            fmt::print("\nFailed to parse image data {}, resampling", item->imageUrl);
+            std::cout.flush();
+            abandonObject(context, item->objectId);
+            continue;
+        }
+
+        // The compressed bytes are only needed further on by a streaming reader.
+        if (item->image)
+            std::vector<uint8_t>().swap(item->data);
+
+        context->decoded.push(std::move(*item));
+    }
+}
+
+static void classifyThread(SampleContext *context) {
+    while (auto item = context->decoded.pop()) {
+        try {
+            if (item->reader)
+                item->result = AnalysisResult(*item->reader);
+            else if (context->options.approximate > 0)
+                item->result = AnalysisResult(*item->image,
+                    Approximation { context->options.approximate, 1024, item->objectId }, context->pool);
+            else
+                item->result = AnalysisResult(*item->image, context->pool);
+        } catch (const std::runtime_error &error) {
+            fmt::print("\nFailed to decode image for object {}, resampling", item->objectId);
+            std::cout.flush();
+            abandonObject(context, item->objectId);
+            continue;
+        }
+
+        try {
+            if (context->store)
+                context->store->insert(item->objectId, storeScale(context->options, item->small), item->result);
+
+            if (context->journal)
+                context->journal->append(item->objectId, item->result);
+        } catch (const std::runtime_error &error) {
+            failRun(context, error.what());
+        }
+
+        // Only the result goes on, the pixels go back to the buffer pool here.
+        item->image.reset();
+        item->reader.reset();
+        std::vector<uint8_t>().swap(item->data);
+
+        context->classified.push(std::move(*item));
+    }
+}
+
+static void aggregateThread(SampleContext *context) {
+    while (auto item = context->classified.pop()) {
+        {
+            std::lock_guard lock(context->mutex);
+
+            SampleContext::Object &object = context->objects[item->objectId];
+            object.state = SampleContext::Object::State::Done;
+            object.result = item->result;
+
+            for (auto [sample, rank] : object.waiting) {
+                context->samples[sample].pending--;
+                context->attach(sample, rank, item->objectId, object.result);
+            }
+
+            object.waiting.clear();
+            context->running--;
+        }
+
+        context->changed.notify_all();
+    }
+}
+
+// Average and peak depth of each stage's input queue, a stage that's always full is the bottleneck.
+static std::string stageReport(const SampleContext &context) {
+    const Options &options = context.options;
+
+    auto line = [](const char *stage, size_t workers, const auto &queue) {
+        auto depth = queue.depth();
+        return fmt::format("{:>10}: {:>3} threads, depth {:.1f} avg, {} peak of {}\n",
+            stage, workers, depth.average, depth.peak, queue.capacity);
+    };
+
+    return "Stage Queues:\n"
+        + line("metadata", 1, context.picked)
+        + line("parse", options.workers(options.parseWorkers), context.queried)
+        + line("image", 1, context.described)
+        + line("decode", options.workers(options.decodeWorkers), context.fetched)
+        + line("classify", options.workers(options.classifyWorkers), context.decoded)
+        + line("aggregate", 1, context.classified);
+}
+
+static void finishSample(size_t index, SampleContext::Sample &sample, const SampleDone &done) {
+    std::sort(sample.results.begin(), sample.results.end(), [](const auto &a, const auto &b) {
+        return a.rank < b.rank;
+    });
+
+    std::vector<AnalysisResult> results;
+    std::vector<size_t> objectIds;
+    results.reserve(sample.results.size());
+    objectIds.reserve(sample.results.size());
+
+    for (auto &entry : sample.results) {
+        results.push_back(std::move(entry.result));
+        objectIds.push_back(entry.objectId);
+    }
+
+    std::vector<SampleContext::Sample::Entry>().swap(sample.results);
+
+    done(index, sample.pool, std::move(results), std::move(objectIds));
+}
+
+void runSamples(const Options &options, const ObjectIds &ids, ThreadPool *pool, DiskCache *cache, ResultStore *store,
+    Journal *journal, Downloader &downloader, const std::vector<uint64_t> &seeds, bool exhaustive, bool keepResults,
+    const SampleDone &done) {
+    SampleContext context(options, ids, pool, cache, store, journal, &downloader, seeds, exhaustive, keepResults);
+
+    // Objects a resumed run got through already go straight to the samples picking them, as they did before, and
+    // those it gave up on are passed over again. The same seeds pick the same candidates, so samples come out
+    // just as they would have.
+    if (journal) {
+        for (const Journal::Entry &entry : journal->recovered) {
+            SampleContext::Object &object = context.objects[entry.objectId];
+            object.state = entry.failed ? SampleContext::Object::State::Failed : SampleContext::Object::State::Done;
+            object.result = entry.result;
+        }
+
+        std::vector<Journal::Entry>().swap(journal->recovered);
+    }
+
+    std::vector<std::thread> threads;
+
+    threads.emplace_back(metadataThread, &context);
+    for (size_t b = 0; b < options.workers(options.parseWorkers); b++)
+        threads.emplace_back(parseThread, &context);
+    threads.emplace_back(imageThread, &context);
+    for (size_t b = 0; b < options.workers(options.decodeWorkers); b++)
+        threads.emplace_back(decodeThread, &context);
+    for (size_t b = 0; b < options.workers(options.classifyWorkers); b++)
+        threads.emplace_back(classifyThread, &context);
+    threads.emplace_back(aggregateThread, &context);
+
+    {
+        std::unique_lock lock(context.mutex);
+
+        while (context.error.empty()) {
+            // Samples before finished are handed on and their results moved out, they mustn't pick again.
+            for (size_t s = context.finished; s < context.samples.size(); s++) {
+                // Just enough candidates to fill the sample once the objects they wait on are through.
+                size_t rank, objectId;
+
+                while (context.samples[s].pool.count + context.samples[s].pending < context.target
+                    && !context.samples[s].exhausted) {
+                    if (!pickObject(context, context.samples[s], rank, objectId)) {
+                        context.samples[s].exhausted = true;
+                        break;
+                    }
+
+                    auto [it, fresh] = context.objects.try_emplace(objectId);
+                    SampleContext::Object &object = it->second;
+
+                    if (!fresh) {
+                        if (object.state == SampleContext::Object::State::Done) {
+                            context.attach(s, rank, objectId, object.result);
+                        } else if (object.state == SampleContext::Object::State::Running) {
+                            object.waiting.emplace_back(s, rank);
+                            context.samples[s].pending++;
+                        }
+
+                        continue;
+                    }
+
+                    // Objects analyzed before skip the pipeline entirely.
+                    if (findStored(options, store, objectId, object.result)) {
+                        object.state = SampleContext::Object::State::Done;
+                        context.attach(s, rank, objectId, object.result);
+                        continue;
+                    }
+
+                    object.waiting.emplace_back(s, rank);
+                    context.samples[s].pending++;
+                    context.running++;
+
+                    SampleContext::Item item;
+                    item.objectId = objectId;
+
+                    // Blocks while the metadata stage is backed up, without holding up the other stages.
+                    lock.unlock();
+                    context.picked.push(std::move(item));
+                    lock.lock();
+                }
+            }
+
+            // Samples go on in order, a complete one waits for those before it.
+            std::vector<std::pair<size_t, SampleContext::Sample *>> complete;
+
+            for (; context.finished < context.samples.size(); context.finished++) {
+                if (!context.samples[context.finished].complete(context.target))
+                    break;
+
+                complete.emplace_back(context.finished, &context.samples[context.finished]);
+            }
+
+            if (!complete.empty()) {
+                // Nothing touches a complete sample any more, so it's handed on without the lock.
+                lock.unlock();
+
+                for (auto [index, sample] : complete)
+                    finishSample(index, *sample, done);
+
+                lock.lock();
+                continue;
+            }
+
+            // Nothing running means every sample is either full or out of candidates, and handed on above.
+            if (context.running == 0)
+                break;
+
+            context.changed.wait(lock);
+        }
+    }
+
+    // Everything picked is through by now, closing lets every stage's threads run out. After an error whatever's
+    // still queued is dropped at the next stage.
+    for (auto *queue : { &context.picked, &context.queried, &context.described, &context.fetched, &context.decoded,
+        &context.classified })
+        queue->close();
+
+    for (std::thread &thread : threads)
+        thread.join();
+
+    // Fetches still running after an error call back into the context.
+    {
+        std::unique_lock lock(context.mutex);
+        context.changed.wait(lock, [&context] { return context.requests == 0; });
+    }
+
+    if (!context.error.empty())
+        throw std::runtime_error(context.error);
+
+    if (options.stageReport)
+        fmt::print("\n{}", stageReport(context));
+}
@@ -0,0 +1,271 @@
+#include <paintings/sink.h>
+
+#include <cmath>
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+// Written out once the buffer holds this much.
+static constexpr size_t blockSize = 64 * 1024;
+
+// Rows per column chunk, and the fewest a flush writes out early.
+static constexpr size_t chunkRows = 64 * 1024;
+static constexpr size_t flushRows = 4096;
+
+ResultSink::ResultSink(const std::string &path) : path(path), stream(path, std::ios::binary) {
+    if (!stream)
+        throw std::runtime_error(fmt::format("Could not open output file \"{}\".", path));
+}
+
+ResultSink::~ResultSink() {
+    drain();
+}
+
+void ResultSink::drain() {
+    stream.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    buffer.clear();
+}
+
+void ResultSink::written() {
+    if (buffer.size() >= blockSize)
+        drain();
+}
+
+void ResultSink::flush() {
+    drain();
+    stream.flush();
+
+    if (!stream)
+        throw std::runtime_error(fmt::format("Failed to write to \"{}\".", path));
+}
+
+// ",,NAME,RED,GREEN,..." like the headers csv2 wrote, one table per group of columns.
+static void appendTable(fmt::memory_buffer &buffer, const char *name) {
+    fmt::format_to(std::back_inserter(buffer), ",,{}", name);
+
+    for (const char *sample : samples)
+        fmt::format_to(std::back_inserter(buffer), ",{}", sample);
+}
+
+// Values under a table, formatted as std::to_string did.
+static void appendValues(fmt::memory_buffer &buffer, const std::array<uint64_t, samples.size()> &values) {
+    buffer.append(std::string_view(",,"));
+
+    for (uint64_t value : values)
+        fmt::format_to(std::back_inserter(buffer), ",{}", value);
+}
+
+static void appendValues(fmt::memory_buffer &buffer, const std::array<double, samples.size()> &values) {
+    buffer.append(std::string_view(",,"));
+
+    for (double value : values)
+        fmt::format_to(std::back_inserter(buffer), ",{:.6f}", value);
+}
+
+CsvSink::CsvSink(const std::string &path, bool raw, bool intervals) : ResultSink(path), intervals(intervals) {
+    if (raw) {
+        buffer.append(std::string_view("Sample #,Object #,# Pixels"));
+        appendTable(buffer, "Frequencies");
+        appendTable(buffer, "Normalized");
+
+        if (intervals) {
+            appendTable(buffer, "Lower");
+            appendTable(buffer, "Upper");
+        }
+    } else {
+        buffer.append(std::string_view("Sample #,# Pictures,# Pixels"));
+        appendTable(buffer, "Frequencies");
+        appendTable(buffer, "Raw");
+        appendTable(buffer, "Average");
+        appendTable(buffer, "Min");
+        appendTable(buffer, "Max");
+        appendTable(buffer, "S.D.");
+    }
+
+    buffer.push_back('\n');
+}
+
+void CsvSink::write(size_t sample, size_t object, size_t, const AnalysisResult &result) {
+    fmt::format_to(std::back_inserter(buffer), "{},{},{}", sample + 1, object + 1, result.numPixels);
+
+    appendValues(buffer, result.sampleFrequency);
+    appendValues(buffer, result.normalized);
+
+    if (intervals) {
+        appendValues(buffer, result.lower);
+        appendValues(buffer, result.upper);
+    }
+
+    buffer.push_back('\n');
+    written();
+}
+
+void CsvSink::write(size_t sample, const AnalysisPool &pool) {
+    fmt::format_to(std::back_inserter(buffer), "{},{},{}", sample + 1, pool.totalPictures, pool.totalPixels);
+
+    appendValues(buffer, pool.rawFrequency);
+    appendValues(buffer, pool.rawNormalized);
+    appendValues(buffer, pool.avgNormal);
+    appendValues(buffer, pool.minNormal);
+    appendValues(buffer, pool.maxNormal);
+    appendValues(buffer, pool.standardDeviation);
+
+    buffer.push_back('\n');
+    written();
+}
+
+// ,"name":{"RED":...,...} with shortest round-trip numbers. JSON has no NaN, a share of no pixels is null.
+template <typename T>
+static void appendObject(fmt::memory_buffer &buffer, const char *name, const std::array<T, samples.size()> &values) {
+    fmt::format_to(std::back_inserter(buffer), ",\"{}\":{{", name);
+
+    for (size_t a = 0; a < samples.size(); a++) {
+        fmt::format_to(std::back_inserter(buffer), "{}\"{}\":", a == 0 ? "" : ",", samples[a]);
+
+        if constexpr (std::is_floating_point_v<T>) {
+            if (!std::isfinite(values[a])) {
+                buffer.append(std::string_view("null"));
+                continue;
+            }
+        }
+
+        fmt::format_to(std::back_inserter(buffer), "{}", values[a]);
+    }
+
+    buffer.push_back('}');
+}
+
+NdjsonSink::NdjsonSink(const std::string &path, bool intervals) : ResultSink(path), intervals(intervals) { }
+
+void NdjsonSink::write(size_t sample, size_t object, size_t objectId, const AnalysisResult &result) {
+    fmt::format_to(std::back_inserter(buffer), "{{\"sample\":{},\"object\":{}", sample + 1, object + 1);
+
+    if (objectId != 0)
+        fmt::format_to(std::back_inserter(buffer), ",\"objectId\":{}", objectId);
+
+    fmt::format_to(std::back_inserter(buffer), ",\"pixels\":{}", result.numPixels);
+
+    appendObject(buffer, "frequencies", result.sampleFrequency);
+    appendObject(buffer, "normalized", result.normalized);
+
+    if (intervals) {
+        appendObject(buffer, "lower", result.lower);
+        appendObject(buffer, "upper", result.upper);
+    }
+
+    buffer.append(std::string_view("}\n"));
+    written();
+}
+
+void NdjsonSink::write(size_t sample, const AnalysisPool &pool) {
+    fmt::format_to(std::back_inserter(buffer), "{{\"sample\":{},\"pictures\":{},\"pixels\":{}",
+        sample + 1, pool.totalPictures, pool.totalPixels);
+
+    appendObject(buffer, "frequencies", pool.rawFrequency);
+    appendObject(buffer, "raw", pool.rawNormalized);
+    appendObject(buffer, "average", pool.avgNormal);
+    appendObject(buffer, "min", pool.minNormal);
+    appendObject(buffer, "max", pool.maxNormal);
+    appendObject(buffer, "sd", pool.standardDeviation);
+
+    buffer.append(std::string_view("}\n"));
+    written();
+}
+
+ColumnSink::ColumnSink(const std::string &path, bool intervals) : ResultSink(path), intervals(intervals) {
+    ColumnFile::Header header = { };
+    std::memcpy(header.magic, ColumnFile::magic, sizeof(header.magic));
+    header.format = ColumnFile::format;
+    header.classes = samples.size();
+    header.flags = intervals ? ColumnFile::intervalFlag : 0;
+
+    buffer.append(reinterpret_cast<const char *>(&header), reinterpret_cast<const char *>(&header + 1));
+
+    for (const char *sample : samples) {
+        char name[ColumnFile::nameSize] = { };
+        std::memcpy(name, sample, std::min(std::strlen(sample), sizeof(name)));
+
+        buffer.append(name, name + sizeof(name));
+    }
+
+    rows.reserve(chunkRows);
+}
+
+ColumnSink::~ColumnSink() {
+    if (!rows.empty())
+        writeChunk();
+}
+
+// Values of one column for every row, zero padded to 8 bytes.
+template <typename T, typename Get>
+static void appendColumn(fmt::memory_buffer &buffer, size_t rows, Get get) {
+    for (size_t a = 0; a < rows; a++) {
+        T value = get(a);
+        buffer.append(reinterpret_cast<const char *>(&value), reinterpret_cast<const char *>(&value + 1));
+    }
+
+    static constexpr char zeros[8] = { };
+    buffer.append(zeros, zeros + (8 - rows * sizeof(T) % 8) % 8);
+}
+
+void ColumnSink::writeChunk() {
+    ColumnFile::ChunkHeader header = { };
+    std::memcpy(header.magic, ColumnFile::chunkMagic, sizeof(header.magic));
+    header.rows = static_cast<uint32_t>(rows.size());
+    header.bytes = ColumnFile::chunkBytes(rows.size(), samples.size(), intervals);
+
+    buffer.append(reinterpret_cast<const char *>(&header), reinterpret_cast<const char *>(&header + 1));
+
+    appendColumn<uint32_t>(buffer, rows.size(), [this](size_t a) { return rows[a].sample; });
+    appendColumn<uint32_t>(buffer, rows.size(), [this](size_t a) { return rows[a].object; });
+    appendColumn<uint64_t>(buffer, rows.size(), [this](size_t a) { return rows[a].objectId; });
+    appendColumn<uint64_t>(buffer, rows.size(), [this](size_t a) { return rows[a].result.numPixels; });
+
+    for (size_t b = 0; b < samples.size(); b++)
+        appendColumn<uint64_t>(buffer, rows.size(), [this, b](size_t a) { return rows[a].result.sampleFrequency[b]; });
+
+    if (intervals) {
+        for (size_t b = 0; b < samples.size(); b++)
+            appendColumn<double>(buffer, rows.size(), [this, b](size_t a) { return rows[a].result.lower[b]; });
+        for (size_t b = 0; b < samples.size(); b++)
+            appendColumn<double>(buffer, rows.size(), [this, b](size_t a) { return rows[a].result.upper[b]; });
+    }
+
+    rows.clear();
+    written();
+}
+
+void ColumnSink::write(size_t sample, size_t object, size_t objectId, const AnalysisResult &result) {
+    rows.push_back({ static_cast<uint32_t>(sample + 1), static_cast<uint32_t>(object + 1), objectId, result });
+
+    if (rows.size() == chunkRows)
+        writeChunk();
+}
+
+void ColumnSink::write(size_t, const AnalysisPool &) {
+    throw std::runtime_error("Column files only hold raw results.");
+}
+
+void ColumnSink::flush() {
+    if (rows.size() >= flushRows)
+        writeChunk();
+
+    ResultSink::flush();
+}
+
+std::unique_ptr<ResultSink> openSink(const std::string &format, const std::string &path, bool raw, bool intervals) {
+    if (format == "csv")
+        return std::make_unique<CsvSink>(path, raw, intervals);
+
+    if (format == "ndjson")
+        return std::make_unique<NdjsonSink>(path, intervals);
+
+    if (format == "columns" && raw)
+        return std::make_unique<ColumnSink>(path, intervals);
+
+    if (format == "columns")
+        throw std::runtime_error("Column files only hold raw results, add --raw.");
+
+    throw std::runtime_error(fmt::format("Unknown output format \"{}\".", format));
+}
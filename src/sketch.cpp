@@ -0,0 +1,114 @@
+#include <paintings/sketch.h>
+
+#include <cmath>
+#include <utility>
+#include <algorithm>
+
+QuantileSketch::QuantileSketch(size_t k) : k(std::max<size_t>(k, 8)), levels(1) { }
+
+// Levels shrink by 2/3 going down from the top, so most of the space goes to values that stand for the most.
+size_t QuantileSketch::capacity(size_t level) const {
+    size_t depth = levels.size() - 1 - level;
+
+    return std::max<size_t>(2, static_cast<size_t>(std::ceil(static_cast<double>(k) * std::pow(2.0 / 3.0, depth))));
+}
+
+size_t QuantileSketch::size() const {
+    size_t held = 0;
+
+    for (const std::vector<double> &level : levels)
+        held += level.size();
+
+    return held;
+}
+
+void QuantileSketch::add(double value) {
+    levels[0].push_back(value);
+    total++;
+
+    if (levels[0].size() >= capacity(0))
+        compress();
+}
+
+void QuantileSketch::merge(const QuantileSketch &other) {
+    if (levels.size() < other.levels.size())
+        levels.resize(other.levels.size());
+
+    for (size_t a = 0; a < other.levels.size(); a++)
+        levels[a].insert(levels[a].end(), other.levels[a].begin(), other.levels[a].end());
+
+    total += other.total;
+
+    compress();
+}
+
+// Compacts the lowest full level, again while the whole sketch holds more than its levels have room for.
+void QuantileSketch::compress() {
+    while (true) {
+        size_t room = 0;
+
+        for (size_t a = 0; a < levels.size(); a++)
+            room += capacity(a);
+
+        if (size() < room)
+            return;
+
+        size_t level = 0;
+
+        while (levels[level].size() < capacity(level))
+            level++;
+
+        if (level + 1 == levels.size())
+            levels.emplace_back();
+
+        std::vector<double> &values = levels[level];
+        std::sort(values.begin(), values.end());
+
+        // An odd value out stays behind.
+        std::vector<double> kept;
+        if (values.size() % 2 == 1) {
+            kept.push_back(values.back());
+            values.pop_back();
+        }
+
+        // xorshift64
+        coin ^= coin << 13;
+        coin ^= coin >> 7;
+        coin ^= coin << 17;
+
+        for (size_t a = coin & 1; a < values.size(); a += 2)
+            levels[level + 1].push_back(values[a]);
+
+        values = std::move(kept);
+    }
+}
+
+double QuantileSketch::quantile(double q) const {
+    std::vector<std::pair<double, uint64_t>> weighted;
+
+    for (size_t a = 0; a < levels.size(); a++) {
+        for (double value : levels[a])
+            weighted.emplace_back(value, uint64_t(1) << a);
+    }
+
+    if (weighted.empty())
+        return 0;
+
+    std::sort(weighted.begin(), weighted.end());
+
+    uint64_t held = 0;
+    for (const auto &[value, weight] : weighted)
+        held += weight;
+
+    double target = std::clamp(q, 0.0, 1.0) * static_cast<double>(held);
+    uint64_t seen = 0;
+
+    for (const auto &[value, weight] : weighted) {
+        seen += weight;
+
+        if (static_cast<double>(seen) >= target)
+            return value;
+    }
+
+    return weighted.back().first;
+}
@@ -0,0 +1,287 @@
+#include <paintings/store.h>
+
+#include <mutex>
+#include <vector>
+#include <cstring>
+#include <stdexcept>
+#include <filesystem>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+
+struct ResultStore::Header {
+    char magic[8];
+    uint32_t format;
+    uint32_t recordSize;
+
+    // Slots, always a power of two, and how many are taken.
+    uint64_t capacity;
+    uint64_t count;
+
+    // The process that has the store open, named to any other that tries to.
+    int32_t holder;
+
+    uint8_t padding[60];
+};
+
+// No normalized values, those follow from the frequencies.
+struct ResultStore::Record {
+    uint64_t objectId;
+
+    // Zero marks an empty slot.
+    uint32_t version;
+    int32_t scale;
+
+    uint64_t numPixels;
+    uint64_t sampleFrequency[samples.size()];
+};
+
+static_assert(sizeof(ResultStore::Header) == 96);
+static_assert(sizeof(ResultStore::Record) == 96);
+
+static constexpr char storeMagic[8] = { 'P', 'A', 'I', 'N', 'T', 'S', 'T', 'R' };
+static constexpr uint32_t storeFormat = 1;
+static constexpr uint64_t initialCapacity = 1024;
+
+ResultStore::ResultStore(const std::string &path) : path(path) {
+    file = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (file < 0)
+        throw std::runtime_error("Could not open result store at \"" + path + "\".");
+
+    if (flock(file, LOCK_EX | LOCK_NB) != 0) {
+        Header existing = { };
+        std::string holder = "another process";
+
+        if (pread(file, &existing, sizeof(existing), 0) == sizeof(existing)
+            && std::memcmp(existing.magic, storeMagic, sizeof(storeMagic)) == 0 && existing.holder > 0)
+            holder = "process " + std::to_string(existing.holder);
+
+        close(file);
+        throw std::runtime_error("Result store at \"" + path + "\" is in use by " + holder
+            + ", only one paintings or analyze-hue run can have it open at a time.");
+    }
+
+    off_t size = lseek(file, 0, SEEK_END);
+
+    if (size == 0) {
+        map(initialCapacity);
+
+        std::memcpy(header->magic, storeMagic, sizeof(storeMagic));
+        header->format = storeFormat;
+        header->recordSize = sizeof(Record);
+        header->capacity = initialCapacity;
+        header->count = 0;
+        header->holder = getpid();
+
+        return;
+    }
+
+    Header existing = { };
+
+    if (pread(file, &existing, sizeof(existing), 0) != sizeof(existing)
+        || std::memcmp(existing.magic, storeMagic, sizeof(storeMagic)) != 0
+        || existing.format != storeFormat
+        || existing.recordSize != sizeof(Record)
+        || static_cast<uint64_t>(size) != sizeof(Header) + existing.capacity * sizeof(Record)) {
+        close(file);
+        throw std::runtime_error("\"" + path + "\" is not a result store.");
+    }
+
+    map(existing.capacity);
+    header->holder = getpid();
+}
+
+ResultStore::~ResultStore() {
+    unmap();
+    close(file);
+}
+
+void ResultStore::map(uint64_t capacity) {
+    size_t bytes = sizeof(Header) + capacity * sizeof(Record);
+
+    if (ftruncate(file, static_cast<off_t>(bytes)) != 0)
+        throw std::runtime_error("Could not grow result store at \"" + path + "\".");
+
+    void *memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    if (memory == MAP_FAILED)
+        throw std::runtime_error("Could not map result store at \"" + path + "\".");
+
+    header = static_cast<Header *>(memory);
+    records = reinterpret_cast<Record *>(header + 1);
+}
+
+void ResultStore::unmap() {
+    if (header)
+        munmap(header, sizeof(Header) + header->capacity * sizeof(Record));
+
+    header = nullptr;
+    records = nullptr;
+}
+
+// The first slot holding this key, or the empty slot it would go in.
+ResultStore::Record *ResultStore::slot(uint64_t objectId, int32_t scale) const {
+    uint64_t hash = (objectId ^ (static_cast<uint64_t>(classifierVersion) << 48) ^ (static_cast<uint64_t>(scale) << 40))
+        * 0x9E3779B97F4A7C15ull;
+    uint64_t mask = header->capacity - 1;
+
+    for (uint64_t index = hash >> 32 & mask;; index = (index + 1) & mask) {
+        Record &record = records[index];
+
+        if (record.version == 0)
+            return &record;
+
+        if (record.objectId == objectId && record.version == classifierVersion && record.scale == scale)
+            return &record;
+    }
+}
+
+bool ResultStore::find(uint64_t objectId, int32_t scale, AnalysisResult &result) const {
+    std::shared_lock lock(mutex);
+
+    const Record *record = slot(objectId, scale);
+    if (record->version == 0)
+        return false;
+
+    std::array<uint64_t, samples.size()> frequency;
+    std::memcpy(frequency.data(), record->sampleFrequency, sizeof(record->sampleFrequency));
+
+    result = AnalysisResult(record->numPixels, frequency);
+
+    return true;
+}
+
+void ResultStore::insert(uint64_t objectId, int32_t scale, const AnalysisResult &result) {
+    if (result.approximate())
+        return;
+
+    std::unique_lock lock(mutex);
+
+    // Kept at most half full so probes stay short.
+    if ((header->count + 1) * 2 > header->capacity)
+        grow();
+
+    Record *record = slot(objectId, scale);
+
+    if (record->version == 0)
+        header->count++;
+
+    record->objectId = objectId;
+    record->scale = scale;
+    record->numPixels = result.numPixels;
+    std::memcpy(record->sampleFrequency, result.sampleFrequency.data(), sizeof(record->sampleFrequency));
+    record->version = classifierVersion;
+}
+
+size_t ResultStore::size() const {
+    std::shared_lock lock(mutex);
+
+    size_t count = 0;
+
+    for (uint64_t a = 0; a < header->capacity; a++)
+        count += records[a].version == classifierVersion;
+
+    return count;
+}
+
+std::vector<AnalysisResult> ResultStore::results(int32_t scale, std::vector<uint64_t> *objectIds) const {
+    std::shared_lock lock(mutex);
+
+    std::vector<AnalysisResult> results;
+    results.reserve(header->count);
+
+    if (objectIds) {
+        objectIds->clear();
+        objectIds->reserve(header->count);
+    }
+
+    for (uint64_t a = 0; a < header->capacity; a++) {
+        const Record &record = records[a];
+
+        if (record.version != classifierVersion || record.scale != scale)
+            continue;
+
+        std::array<uint64_t, samples.size()> frequency;
+        std::memcpy(frequency.data(), record.sampleFrequency, sizeof(record.sampleFrequency));
+
+        results.emplace_back(record.numPixels, frequency);
+
+        if (objectIds)
+            objectIds->push_back(record.objectId);
+    }
+
+    return results;
+}
+
+// Doubles the table. Records are rehashed into a new file next to the store, dropping those of older classifier
+// versions, and that file is renamed over the store once it's complete and on disk. A crash at any point leaves
+// either the old store or the new one, never a half grown one.
+void ResultStore::grow() {
+    uint64_t capacity = header->capacity * 2;
+    std::string grownPath = path + ".grow";
+
+    // Locked before it takes the store's place, so no other process can open it in between.
+    int grown = open(grownPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (grown < 0 || flock(grown, LOCK_EX | LOCK_NB) != 0) {
+        if (grown >= 0)
+            close(grown);
+
+        throw std::runtime_error("Could not grow result store at \"" + path + "\".");
+    }
+
+    int oldFile = file;
+    Header *oldHeader = header;
+    Record *oldRecords = records;
+
+    auto restore = [&]() {
+        close(grown);
+        unlink(grownPath.c_str());
+
+        file = oldFile;
+        header = oldHeader;
+        records = oldRecords;
+    };
+
+    file = grown;
+
+    try {
+        map(capacity);
+    } catch (...) {
+        restore();
+        throw;
+    }
+
+    std::memcpy(header, oldHeader, sizeof(Header));
+    header->capacity = capacity;
+    header->count = 0;
+
+    for (uint64_t a = 0; a < oldHeader->capacity; a++) {
+        const Record &record = oldRecords[a];
+
+        if (record.version != classifierVersion)
+            continue;
+
+        *slot(record.objectId, record.scale) = record;
+        header->count++;
+    }
+
+    if (msync(header, sizeof(Header) + capacity * sizeof(Record), MS_SYNC) != 0
+        || rename(grownPath.c_str(), path.c_str()) != 0) {
+        unmap();
+        restore();
+        throw std::runtime_error("Could not grow result store at \"" + path + "\".");
+    }
+
+    // The rename itself is only durable once the directory is synced.
+    std::string directory = std::filesystem::path(path).parent_path().string();
+    int parent = open(directory.empty() ? "." : directory.c_str(), O_RDONLY);
+
+    if (parent >= 0) {
+        fsync(parent);
+        close(parent);
+    }
+
+    munmap(oldHeader, sizeof(Header) + oldHeader->capacity * sizeof(Record));
+    close(oldFile);
+}
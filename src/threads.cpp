@@ -0,0 +1,81 @@
+#include <paintings/threads.h>
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t threads) {
+    this->threads.reserve(threads);
+
+    for (size_t a = 0; a < threads; a++)
+        this->threads.emplace_back(&ThreadPool::workerThread, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+
+    available.notify_all();
+
+    for (std::thread &thread : threads)
+        thread.join();
+}
+
+void ThreadPool::run(size_t count, const std::function<void(size_t)> &task) {
+    if (count == 0)
+        return;
+
+    auto job = std::make_shared<Job>(task, count);
+
+    {
+        std::lock_guard lock(mutex);
+        jobs.push_back(job);
+    }
+
+    available.notify_all();
+
+    // The caller helps out, so a busy (or empty) pool never stalls it.
+    work(*job);
+    retire(job);
+
+    std::unique_lock lock(mutex);
+    finished.wait(lock, [&job] { return job->done == job->count; });
+}
+
+void ThreadPool::work(Job &job) {
+    for (size_t index = job.next++; index < job.count; index = job.next++) {
+        job.task(index);
+
+        if (++job.done == job.count) {
+            { std::lock_guard lock(mutex); }
+            finished.notify_all();
+        }
+    }
+}
+
+void ThreadPool::retire(const std::shared_ptr<Job> &job) {
+    std::lock_guard lock(mutex);
+
+    auto it = std::find(jobs.begin(), jobs.end(), job);
+    if (it != jobs.end())
+        jobs.erase(it);
+}
+
+void ThreadPool::workerThread() {
+    while (true) {
+        std::shared_ptr<Job> job;
+
+        {
+            std::unique_lock lock(mutex);
+            available.wait(lock, [this] { return stopping || !jobs.empty(); });
+
+            if (jobs.empty())
+                return;
+
+            job = jobs.front();
+        }
+
+        work(*job);
+        retire(job);
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <string>
+
+// Tests are plain executables, each failed check is printed and main returns failures() for ctest.
+inline int &failureCount() {
+    static int count = 0;
+    return count;
+}
+
+inline void check(bool ok, const std::string &what) {
+    if (ok)
+        return;
+
+    fmt::print("FAILED: {}\n", what);
+    failureCount()++;
+}
+
+inline int failures() {
+    if (failureCount() == 0)
+        fmt::print("All checks passed.\n");
+
+    return failureCount() == 0 ? 0 : 1;
+}
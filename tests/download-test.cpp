@@ -0,0 +1,100 @@
+#include "check.h"
+#include "stub-server.h"
+
+#include <paintings/download.h>
+
+#include <map>
+#include <chrono>
+
+// Throttles requests with 429 and Retry-After against a stub server. Checks that the Downloader waits as told and
+// then gets through, that the controller backs its window off, that a Retry-After too big for any integer is
+// capped instead of throwing on the download thread, and that a request throttled every time fails in the end.
+int main() {
+    std::mutex mutex;
+    std::map<std::string, size_t> hits;
+
+    StubServer server([&](const std::string &path) {
+        size_t hit;
+        {
+            std::lock_guard lock(mutex);
+            hit = hits[path]++;
+        }
+
+        StubServer::Reply reply;
+
+        if (path.compare(0, 6, "/slow/") == 0 && hit == 0)
+            reply = { 429, "", { "Retry-After: 1" } };
+        else if (path.compare(0, 6, "/huge/") == 0 && hit == 0)
+            reply = { 429, "", { "Retry-After: 99999999999999999999999999" } };
+        else if (path.compare(0, 6, "/junk/") == 0 && hit == 0)
+            reply = { 429, "", { "Retry-After: -5" } };
+        else if (path == "/always")
+            reply = { 429, "", { "Retry-After: 0" } };
+        else
+            reply.body = "ok " + path;
+
+        return reply;
+    });
+
+    using Clock = std::chrono::steady_clock;
+
+    auto seconds = [](Clock::time_point since) {
+        return std::chrono::duration<double>(Clock::now() - since).count();
+    };
+
+    RateController::Settings settings;
+    settings.initial = 8;
+    settings.maxRetryAfter = std::chrono::seconds(2);
+
+    Downloader downloader(settings);
+
+    // Every one is throttled once and told to wait a second.
+    {
+        auto start = Clock::now();
+        std::vector<std::future<Downloader::Response>> responses;
+
+        for (size_t a = 0; a < 8; a++)
+            responses.push_back(downloader.get(server.url("/slow/" + std::to_string(a))));
+
+        for (size_t a = 0; a < responses.size(); a++) {
+            Downloader::Response response = responses[a].get();
+            std::string body(response.body.begin(), response.body.end());
+
+            check(response.status == 200 && body == "ok /slow/" + std::to_string(a),
+                fmt::format("/slow/{} came back {} \"{}\" after a 429", a, response.status, body));
+        }
+
+        check(seconds(start) >= 0.9, fmt::format("retried after {:.2f} s despite Retry-After: 1", seconds(start)));
+
+        RateController::Stats stats = downloader.stats();
+
+        check(stats.throttled >= 8, fmt::format("{} of 8 throttled responses counted", stats.throttled));
+        check(stats.decreases > 0 && stats.peakWindow >= 8 && stats.window < stats.peakWindow,
+            fmt::format("window went {} to {} over {} decreases on 429s", stats.peakWindow, stats.window,
+                stats.decreases));
+    }
+
+    // Past maxRetryAfter the wait is capped, and a Retry-After that isn't a count of seconds gets the usual delay.
+    {
+        auto start = Clock::now();
+
+        Downloader::Response huge = downloader.get(server.url("/huge/0")).get();
+        check(huge.status == 200, fmt::format("huge Retry-After came back {}", huge.status));
+
+        Downloader::Response junk = downloader.get(server.url("/junk/0")).get();
+        check(junk.status == 200, fmt::format("negative Retry-After came back {}", junk.status));
+
+        check(seconds(start) < 5, fmt::format("huge Retry-After held the request {:.2f} s", seconds(start)));
+    }
+
+    // Out of retries, the 429 itself is passed on.
+    {
+        Downloader::Response response = downloader.get(server.url("/always")).get();
+
+        check(response.status == 429, fmt::format("throttled every time came back {}", response.status));
+        check(hits["/always"] == settings.retries + 1,
+            fmt::format("/always was tried {} times for {} retries", hits["/always"], settings.retries));
+    }
+
+    return failures();
+}
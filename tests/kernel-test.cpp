@@ -0,0 +1,99 @@
+#include "check.h"
+
+#include <paintings/kernel.h>
+
+#include <vector>
+
+// Every kernel the CPU runs against the plain classifiers, over all 2^24 colors. Colors are grouped by the class
+// the classifier gives them, so a kernel passes only if it puts every single color of a group in that class.
+static std::vector<Kernel> supportedKernels() {
+    std::vector<Kernel> kernels;
+
+    for (Kernel kernel : { Kernel::Scalar, Kernel::SSE41, Kernel::AVX2, Kernel::AVX512 }) {
+        if (kernel <= bestKernel())
+            kernels.push_back(kernel);
+    }
+
+    return kernels;
+}
+
+static void appendPixel(std::vector<uint8_t> &pixels, uint32_t color) {
+    RGB rgb(color);
+
+    pixels.push_back(rgb.red);
+    pixels.push_back(rgb.green);
+    pixels.push_back(rgb.blue);
+}
+
+static void testClassify() {
+    std::vector<std::vector<uint8_t>> groups(HueColors::size);
+    const ColorTable<HueColors> &table = ColorTable<HueColors>::get();
+    size_t tableMismatches = 0;
+
+    for (uint32_t color = 0; color < (1u << 24u); color++) {
+        size_t expected = HueColors::classify(HSL(RGB(color)));
+
+        tableMismatches += table.classify(RGB(color)) != expected;
+        appendPixel(groups[expected], color);
+    }
+
+    check(tableMismatches == 0, fmt::format("color table differs from HSL classify on {} colors", tableMismatches));
+
+    for (Kernel kernel : supportedKernels()) {
+        for (size_t group = 0; group < groups.size(); group++) {
+            std::array<uint64_t, HueColors::size> frequency = { };
+            size_t count = groups[group].size() / 3;
+
+            classifyPixels<HueColors>(groups[group].data(), count, frequency.data(), kernel);
+
+            check(frequency[group] == count, fmt::format("{} puts {} of {} {} colors elsewhere",
+                kernelName(kernel), count - frequency[group], count, HueColors::names[group]));
+        }
+    }
+}
+
+// L1 and squared L2 pick their nearest colors separately, so each is checked over its own grouping, with the
+// summed distances too.
+template <bool squared>
+static void testNearest() {
+    std::vector<std::vector<uint8_t>> groups(TrueColors::size);
+    std::vector<uint64_t> distances(TrueColors::size);
+
+    for (uint32_t color = 0; color < (1u << 24u); color++) {
+        auto match = TrueColors::nearest<squared>(RGB(color));
+
+        appendPixel(groups[match.index], color);
+        distances[match.index] += match.distance;
+    }
+
+    const char *metric = squared ? "squared L2" : "L1";
+
+    for (Kernel kernel : supportedKernels()) {
+        for (size_t group = 0; group < groups.size(); group++) {
+            std::array<uint64_t, TrueColors::size> frequency = { }, squaredFrequency = { };
+            std::array<uint64_t, TrueColors::size> score = { }, squaredScore = { };
+            size_t count = groups[group].size() / 3;
+
+            NearestCounts counts = { frequency.data(), squaredFrequency.data(), score.data(), squaredScore.data() };
+            nearestPixels<TrueColors>(groups[group].data(), count, counts, kernel);
+
+            uint64_t matched = squared ? squaredFrequency[group] : frequency[group];
+            uint64_t summed = squared ? squaredScore[group] : score[group];
+
+            check(matched == count, fmt::format("{} {} puts {} of {} {} colors elsewhere",
+                kernelName(kernel), metric, count - matched, count, TrueColors::names[group]));
+            check(summed == distances[group], fmt::format("{} {} sums {} distance for {}, not {}",
+                kernelName(kernel), metric, summed, TrueColors::names[group], distances[group]));
+        }
+    }
+}
+
+int main() {
+    fmt::print("Best kernel: {}\n", kernelName(bestKernel()));
+
+    testClassify();
+    testNearest<false>();
+    testNearest<true>();
+
+    return failures();
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <algorithm>
+#include <vector>
+#include <cstdint>
+
+// Smallest possible PNG writer for test images, RGB at 8 bits with the pixel data in stored (uncompressed)
+// deflate blocks, so tests don't depend on an encoder being around.
+inline std::string encodePng(uint32_t width, uint32_t height, const std::vector<uint8_t> &rgb) {
+    auto crc = [](const std::string &data) {
+        uint32_t value = 0xFFFFFFFFu;
+
+        for (unsigned char c : data) {
+            value ^= c;
+
+            for (int a = 0; a < 8; a++)
+                value = value & 1 ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+        }
+
+        return ~value;
+    };
+
+    auto be32 = [](uint32_t value) {
+        return std::string { char(value >> 24), char(value >> 16), char(value >> 8), char(value) };
+    };
+
+    auto chunk = [&](const std::string &type, const std::string &data) {
+        return be32(static_cast<uint32_t>(data.size())) + type + data + be32(crc(type + data));
+    };
+
+    // Every row starts with filter type 0.
+    std::string raw;
+    for (uint32_t y = 0; y < height; y++) {
+        raw.push_back(0);
+        raw.append(reinterpret_cast<const char *>(rgb.data()) + y * width * 3, width * 3);
+    }
+
+    std::string zlib = { 0x78, 0x01 };
+
+    for (size_t at = 0; at < raw.size() || at == 0;) {
+        size_t size = std::min<size_t>(raw.size() - at, 65535);
+        bool last = at + size == raw.size();
+
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(char(size));
+        zlib.push_back(char(size >> 8));
+        zlib.push_back(char(~size));
+        zlib.push_back(char(~size >> 8));
+        zlib.append(raw, at, size);
+
+        at += size;
+        if (last)
+            break;
+    }
+
+    uint32_t a = 1, b = 0;
+    for (unsigned char c : raw) {
+        a = (a + c) % 65521;
+        b = (b + a) % 65521;
+    }
+
+    zlib += be32(b << 16 | a);
+
+    std::string header = be32(width) + be32(height) + std::string { 8, 2, 0, 0, 0 };
+
+    return std::string("\x89PNG\r\n\x1a\n", 8) + chunk("IHDR", header) + chunk("IDAT", zlib) + chunk("IEND", "");
+}
@@ -0,0 +1,199 @@
+#include "png.h"
+#include "check.h"
+#include "stub-server.h"
+
+#include <paintings/journal.h>
+#include <paintings/sampler.h>
+#include <paintings/download.h>
+
+#include <map>
+#include <set>
+#include <cmath>
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <csignal>
+
+#include <unistd.h>
+#include <sys/resource.h>
+
+// Runs several samples against a stub API where some objects fail, and checks that every object is fetched at
+// most once and that no sample picks more candidates than it needs to fill up. Then runs again with a journal
+// that can't be written past a few records, which has to stop the run with an error instead of crashing it.
+int main() {
+    std::vector<uint8_t> pixels(32 * 24 * 3);
+    for (size_t a = 0; a < pixels.size(); a++)
+        pixels[a] = static_cast<uint8_t>(a * 37);
+
+    std::string image = encodePng(32, 24, pixels);
+
+    std::mutex mutex;
+    std::map<size_t, size_t> requested;
+
+    // Requests the server is answering at once, each held up a little like over a real network.
+    size_t answering = 0, peakAnswering = 0;
+
+    // Set once the server is up, before anything is requested.
+    std::string base;
+
+    StubServer server([&](const std::string &path) {
+        StubServer::Reply reply;
+
+        {
+            std::lock_guard lock(mutex);
+            peakAnswering = std::max(peakAnswering, ++answering);
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+        {
+            std::lock_guard lock(mutex);
+            answering--;
+        }
+
+        if (path.rfind("/objects/", 0) == 0) {
+            size_t objectId = std::stoull(path.substr(9));
+
+            {
+                std::lock_guard lock(mutex);
+                requested[objectId]++;
+            }
+
+            // Every seventh object is missing, its candidates are replaced.
+            if (objectId % 7 == 0) {
+                reply.status = 404;
+                return reply;
+            }
+
+            reply.body = fmt::format("{{\"objectID\":{},\"primaryImage\":\"{}images/{}.png\"}}",
+                objectId, base, objectId);
+        } else if (path.rfind("/images/", 0) == 0) {
+            reply.body = image;
+        } else {
+            reply.status = 404;
+        }
+
+        return reply;
+    });
+
+    base = server.url();
+
+    const char *args[] = { "sampler-test" };
+    Options options(1, args);
+    options.url = base;
+    options.sampleSize = 15;
+    options.sampleCount = 6;
+    options.parseWorkers = 1;
+    options.threads = 2;
+
+    ObjectIds ids;
+    for (uint32_t a = 1; a <= 400; a++)
+        ids.push_back(a);
+
+    std::vector<uint64_t> seeds;
+    for (size_t a = 0; a < options.sampleCount; a++)
+        seeds.push_back(sampleSeed(99, a));
+
+    Downloader downloader(RateController::Settings { });
+
+    std::vector<std::vector<size_t>> picked(seeds.size());
+    std::vector<PoolAccumulator> pools(seeds.size());
+    size_t order = 0;
+    bool inOrder = true;
+
+    runSamples(options, ids, nullptr, nullptr, nullptr, nullptr, downloader, seeds, false, true,
+        [&](size_t sample, const PoolAccumulator &pool, std::vector<AnalysisResult> &&results,
+            std::vector<size_t> &&objectIds) {
+            inOrder &= sample == order++;
+            picked[sample] = objectIds;
+            pools[sample] = pool;
+
+            check(results.size() == options.sampleSize,
+                fmt::format("sample {} has {} results", sample, results.size()));
+
+            // The pool fed as results came in is the one of the ranked results, up to rounding.
+            AnalysisPool streamed(pool), ranked(results);
+
+            check(streamed.totalPictures == ranked.totalPictures && streamed.totalPixels == ranked.totalPixels
+                && streamed.rawFrequency == ranked.rawFrequency && streamed.minNormal == ranked.minNormal
+                && streamed.maxNormal == ranked.maxNormal,
+                fmt::format("sample {} pool differs from its results", sample));
+
+            for (size_t a = 0; a < samples.size(); a++) {
+                check(std::abs(streamed.avgNormal[a] - ranked.avgNormal[a]) < 1e-12
+                    && std::abs(streamed.standardDeviation[a] - ranked.standardDeviation[a]) < 1e-12,
+                    fmt::format("sample {} average or SD of class {} differs from its results", sample, a));
+            }
+        });
+
+    check(inOrder && order == seeds.size(), "samples are handed on once each, in order");
+
+    std::set<size_t> used;
+    for (size_t sample = 0; sample < picked.size(); sample++) {
+        std::set<size_t> unique(picked[sample].begin(), picked[sample].end());
+        check(unique.size() == picked[sample].size(), fmt::format("sample {} holds an object twice", sample));
+
+        for (size_t objectId : picked[sample]) {
+            check(objectId % 7 != 0, fmt::format("sample {} holds failed object {}", sample, objectId));
+            used.insert(objectId);
+        }
+    }
+
+    // Every object fetched that didn't fail went into some sample, anything else was a candidate too many.
+    size_t fetched = 0;
+
+    for (auto [objectId, count] : requested) {
+        check(count == 1, fmt::format("object {} was fetched {} times", objectId, count));
+        fetched += objectId % 7 != 0;
+    }
+
+    check(fetched == used.size(), fmt::format("{} objects fetched for {} used in samples", fetched, used.size()));
+
+    // Fetches don't hold a thread each, the downloader's window decides how many run at once.
+    check(peakAnswering >= 8, fmt::format("at most {} requests in flight at once", peakAnswering));
+
+    // Without the results samples only hold their pools, which come out the same.
+    order = 0;
+
+    runSamples(options, ids, nullptr, nullptr, nullptr, nullptr, downloader, seeds, false, false,
+        [&](size_t sample, const PoolAccumulator &pool, std::vector<AnalysisResult> &&results,
+            std::vector<size_t> &&objectIds) {
+            order++;
+
+            check(results.empty() && objectIds.empty(), fmt::format("sample {} kept its results", sample));
+            check(pool.count == pools[sample].count && pool.pixels == pools[sample].pixels
+                && pool.frequency == pools[sample].frequency, fmt::format("sample {} pooled other results", sample));
+        });
+
+    check(order == seeds.size(), "samples without results are handed on too");
+
+    // Writes past the limit fail with EFBIG instead of raising SIGXFSZ.
+    std::string path = fmt::format("/tmp/sampler-test-{}.journal", getpid());
+    unlink(path.c_str());
+
+    signal(SIGXFSZ, SIG_IGN);
+
+    rlimit limit;
+    getrlimit(RLIMIT_FSIZE, &limit);
+    rlimit small = { 1024, limit.rlim_max };
+    setrlimit(RLIMIT_FSIZE, &small);
+
+    std::string error;
+
+    try {
+        Journal journal(path, false, 99, journalSettings(options, ids));
+
+        runSamples(options, ids, nullptr, nullptr, nullptr, &journal, downloader, { sampleSeed(100, 0) }, false,
+            false, [](size_t, const PoolAccumulator &, std::vector<AnalysisResult> &&, std::vector<size_t> &&) { });
+    } catch (const std::runtime_error &e) {
+        error = e.what();
+    }
+
+    setrlimit(RLIMIT_FSIZE, &limit);
+    unlink(path.c_str());
+
+    check(error.find("Could not write to journal") != std::string::npos,
+        fmt::format("a full journal stops the run with \"{}\"", error));
+
+    return failures();
+}
@@ -0,0 +1,82 @@
+#include "check.h"
+
+#include <paintings/store.h>
+
+#include <unistd.h>
+
+// Fills a store well past its first few grows and checks every result is still found, also after reopening it,
+// and that a second open while it's held is refused.
+int main() {
+    std::string path = fmt::format("/tmp/store-test-{}.store", getpid());
+    unlink(path.c_str());
+
+    auto resultFor = [](uint64_t objectId) {
+        std::array<uint64_t, samples.size()> frequency = { };
+        for (size_t a = 0; a < samples.size(); a++)
+            frequency[a] = (objectId * 31 + a) % 1000;
+
+        uint64_t total = 0;
+        for (uint64_t value : frequency)
+            total += value;
+
+        return AnalysisResult(total, frequency);
+    };
+
+    constexpr uint64_t objects = 20000;
+
+    auto verify = [&](const ResultStore &store, const char *when) {
+        size_t missing = 0;
+
+        for (uint64_t objectId = 1; objectId <= objects; objectId++) {
+            AnalysisResult result;
+
+            if (!store.find(objectId, 1, result) || result.sampleFrequency != resultFor(objectId).sampleFrequency)
+                missing++;
+        }
+
+        check(missing == 0, fmt::format("{} results lost {}", missing, when));
+        check(store.size() == objects, fmt::format("{} results counted {}", store.size(), when));
+    };
+
+    {
+        ResultStore store(path);
+
+        for (uint64_t objectId = 1; objectId <= objects; objectId++)
+            store.insert(objectId, 1, resultFor(objectId));
+
+        verify(store, "after growing");
+    }
+
+    {
+        ResultStore store(path);
+        verify(store, "after reopening");
+
+        // Listed results come with the ID each was stored under.
+        std::vector<uint64_t> objectIds;
+        std::vector<AnalysisResult> results = store.results(1, &objectIds);
+        size_t mismatched = results.size() != objects || objectIds.size() != objects;
+
+        for (size_t a = 0; a < results.size() && a < objectIds.size(); a++)
+            mismatched += results[a].sampleFrequency != resultFor(objectIds[a]).sampleFrequency;
+
+        check(mismatched == 0, fmt::format("{} listed results don't go with their object IDs", mismatched));
+
+        // A second open is refused and told who has the store.
+        std::string message;
+
+        try {
+            ResultStore second(path);
+        } catch (const std::runtime_error &error) {
+            message = error.what();
+        }
+
+        check(message.find("process " + std::to_string(getpid())) != std::string::npos,
+            fmt::format("second open of the store gave \"{}\"", message));
+    }
+
+    check(access((path + ".grow").c_str(), F_OK) != 0, "the grown table replaced the store");
+
+    unlink(path.c_str());
+
+    return failures();
+}
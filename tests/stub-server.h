@@ -0,0 +1,119 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <stdexcept>
+
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+// HTTP server on a free port of 127.0.0.1 that answers every GET through a handler, one connection per
+// request. Just enough of HTTP/1.1 for the Downloader to talk to, so tests run without the network.
+struct StubServer {
+    struct Reply {
+        int status = 200;
+        std::string body;
+
+        // Extra header lines such as "Retry-After: 1".
+        std::vector<std::string> headers;
+    };
+
+    using Handler = std::function<Reply(const std::string &path)>;
+
+    explicit StubServer(Handler handler) : handler(std::move(handler)) {
+        listener = socket(AF_INET, SOCK_STREAM, 0);
+
+        int on = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+        sockaddr_in address = { };
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        socklen_t size = sizeof(address);
+
+        if (bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0
+            || listen(listener, 1024) != 0
+            || getsockname(listener, reinterpret_cast<sockaddr *>(&address), &size) != 0)
+            throw std::runtime_error("Could not start the stub server.");
+
+        port = ntohs(address.sin_port);
+
+        thread = std::thread([this] { serve(); });
+    }
+
+    ~StubServer() {
+        shutdown(listener, SHUT_RDWR);
+        close(listener);
+        thread.join();
+
+        for (std::thread &connection : connections)
+            connection.join();
+    }
+
+    std::string url(const std::string &path = "/") const {
+        return "http://127.0.0.1:" + std::to_string(port) + path;
+    }
+
+private:
+    Handler handler;
+    int listener = -1;
+    uint16_t port = 0;
+
+    std::thread thread;
+    std::vector<std::thread> connections;
+
+    void serve() {
+        while (true) {
+            int connection = accept(listener, nullptr, nullptr);
+            if (connection < 0)
+                return;
+
+            connections.emplace_back([this, connection] { respond(connection); });
+        }
+    }
+
+    void respond(int connection) {
+        std::string request;
+        char buffer[4096];
+
+        while (request.find("\r\n\r\n") == std::string::npos) {
+            ssize_t got = recv(connection, buffer, sizeof(buffer), 0);
+            if (got <= 0) {
+                close(connection);
+                return;
+            }
+
+            request.append(buffer, static_cast<size_t>(got));
+        }
+
+        // "GET /path HTTP/1.1"
+        size_t start = request.find(' ') + 1;
+        std::string path = request.substr(start, request.find(' ', start) - start);
+
+        Reply reply = handler(path);
+
+        std::string response = "HTTP/1.1 " + std::to_string(reply.status) + " Stub\r\n"
+            + "Content-Length: " + std::to_string(reply.body.size()) + "\r\nConnection: close\r\n";
+
+        for (const std::string &header : reply.headers)
+            response += header + "\r\n";
+
+        response += "\r\n" + reply.body;
+
+        for (size_t sent = 0; sent < response.size();) {
+            ssize_t wrote = send(connection, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+            if (wrote <= 0)
+                break;
+
+            sent += static_cast<size_t>(wrote);
+        }
+
+        close(connection);
+    }
+};